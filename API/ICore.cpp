@@ -17,6 +17,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include <Engine/Base/Console_internal.h>
 #include "Query/QueryManager.h"
+#include "Base/Unzip.h"
 
 #include <STLIncludesBegin.h>
 #include <string>
@@ -318,6 +319,9 @@ void Core(void) {
   _pShell->DeclareSymbol("user void IncludeScript(CTString);", &IncludeScript);
   _pShell->DeclareSymbol("user void ClearConsole(void);", &ClearConsole);
 
+  // Archive handling
+  IUnzip::RegisterSymbols();
+
   // Current values of input axes
   static const CTString strAxisValues(0, "user const FLOAT inp_afAxisValues[%d];", MAX_OVERALL_AXES);
   _pShell->DeclareSymbol(strAxisValues, &inp_afAxisValues);
@@ -15,6 +15,8 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "StdH.h"
 
+#include "Networking/ExtPackets.h"
+#include "Networking/NetworkFunctions.h"
 #include "Networking/Modules/ClientLogging.h"
 
 // Auto update shadows upon loading into worlds
@@ -45,12 +47,23 @@ void UpdateShadows(void)
 // Called every simulation tick
 void IHooks::OnTick(void)
 {
+  // Clients may have changed their state since the last tick
+  INetwork::InvalidateCensus();
+
   // Call step function for each plugin
   FOREACHPLUGIN(itPlugin) {
     if (itPlugin->pm_events.m_processing->OnStep == NULL) continue;
 
     itPlugin->pm_events.m_processing->OnStep();
   }
+
+#if _PATCHCONFIG_EXT_PACKETS
+  // Send extension packets queued during this tick
+  if (_pNetwork->IsServer()) {
+    CExtPacket::FlushQueue();
+    CExtPacket::FlushBatch();
+  }
+#endif
 };
 
 // Called every render frame
@@ -119,6 +132,17 @@ void IHooks::OnGameStart(void)
 // Called after changing the level
 void IHooks::OnChangeLevel(void)
 {
+#if _PATCHCONFIG_EXT_PACKETS
+  // Discard packets that refer to entities from the previous level
+  CExtPacket::ResetQueue();
+  CExtPacket::ResetBatch();
+
+  // Entities from the previous level are gone, so make the server send absolute values and full class files again
+  // Clients keep their dictionaries until the session is reset, since they may still receive references to them
+  CExtEntityPacket::ResetBaselines(TRUE, FALSE);
+  CExtEntityCreate::ResetLearnedClasses(TRUE, FALSE);
+#endif
+
   // Call level change function for each plugin
   FOREACHPLUGIN(itPlugin) {
     if (itPlugin->pm_events.m_game->OnChangeLevel == NULL) continue;
@@ -234,6 +258,12 @@ void IHooks::OnDemoPlay(const CTFileName &fnmDemo)
 // Called after starting demo recording
 void IHooks::OnDemoStart(const CTFileName &fnmDemo)
 {
+#if _PATCHCONFIG_EXT_PACKETS
+  // Demo playback will only know about entity placements and class files sent after this point
+  CExtEntityPacket::ResetBaselines(TRUE, FALSE);
+  CExtEntityCreate::ResetLearnedClasses(TRUE, FALSE);
+#endif
+
   // Call demo start function for each plugin
   FOREACHPLUGIN(itPlugin) {
     if (itPlugin->pm_events.m_demo->OnDemoStart == NULL) continue;
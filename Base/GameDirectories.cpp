@@ -16,6 +16,10 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "StdH.h"
 
 #include "Unzip.h"
+#include "Interfaces/HashFunctions.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
 
 // Other game directories
 CTString _astrGameDirs[GAME_DIRECTORIES_CT];
@@ -183,22 +187,18 @@ void ListGameFiles(CFileList &afnmFiles, const CTString &strDir, const CTString
 
   // Search for files in the archives
   if (!(ulFlags & FLF_IGNOREGRO)) {
-    INDEX ctFilesInZips = IUnzip::GetFileCount();
+    // [Cecil] Only go through files under this directory
+    CStaticStackArray<INDEX> aiFilesInDir;
+    IUnzip::ListDirectory(aiFilesInDir, strDir, bRecursive);
+
+    const INDEX ctFilesInDir = aiFilesInDir.Count();
 
-    for (INDEX iFileInZip = 0; iFileInZip < ctFilesInZips; iFileInZip++) {
+    for (INDEX iFileInDir = 0; iFileInDir < ctFilesInDir; iFileInDir++) {
       // Get ZIP entry
+      const INDEX iFileInZip = aiFilesInDir[iFileInDir];
       const CZipEntry &ze = IUnzip::GetEntry(iFileInZip);
       const CTFileName &fnm = ze.ze_fnm;
 
-      // Skip if not under this directory
-      if (bRecursive) {
-        if (!fnm.HasPrefix(strDir)) continue;
-
-      // Skip if not the same directory
-      } else if (fnm.FileDir() != strDir) {
-        continue;
-      }
-
       // Doesn't match the pattern
       if (strPattern != "" && !fnm.Matches(strPattern)) continue;
 
@@ -264,3 +264,145 @@ void ListGameFiles(CFileList &afnmFiles, const CTString &strDir, const CTString
     }
   }
 };
+
+// [Cecil] Pair of a file and its replacement
+struct FileReplacement {
+  CTString fr_strSource;
+  CTString fr_strReplacement;
+};
+
+// [Cecil] Parsed list of base replacements
+static CStaticStackArray<FileReplacement> _aFileReplacements;
+
+// [Cecil] Hash table with indices of source files in '_aFileReplacements'
+static CStaticArray<INDEX> _aiReplacementIndex;
+
+// [Cecil] Version of the list that has been parsed
+static CTString _strReplacementsPath;
+static SQUAD _llReplacementsVersion = -1;
+
+// [Cecil] Determine which file the list is read from and its current version
+static void GetReplacementsVersion(const CTFileName &fnmList, CTString &strPath, SQUAD &llVersion)
+{
+  CTFileName fnmExpanded;
+  const INDEX iType = ExpandFilePath(EFP_READ, fnmList, fnmExpanded);
+
+  strPath = fnmExpanded;
+  llVersion = -1;
+
+  // Size and modification time of a file on disk
+  if (iType == EFP_FILE) {
+    struct _stati64 statFile;
+
+    if (_stati64(fnmExpanded.str_String, &statFile) == 0) {
+      llVersion = ((SQUAD)statFile.st_mtime << 32) ^ statFile.st_size;
+    }
+
+  // Checksum of a file in some archive
+  } else if (iType == EFP_BASEZIP || iType == EFP_MODZIP) {
+    const INDEX iFile = IUnzip::GetFileIndex(fnmExpanded);
+
+    if (iFile != -1) {
+      const CZipEntry &ze = IUnzip::GetEntry(iFile);
+
+      strPath = *ze.ze_pfnmArchive + ":" + ze.ze_fnm;
+      llVersion = ((SQUAD)ze.ze_ulCRC << 32) ^ ze.ze_slUncompressedSize;
+    }
+  }
+};
+
+// [Cecil] Parse the list of base replacements
+static void LoadFileReplacements(const CTFileName &fnmList)
+{
+  _aFileReplacements.PopAll();
+  _aiReplacementIndex.Clear();
+
+  try {
+    char strLine[256];
+    char strSource[256];
+    char strRemap[256];
+
+    // Read list with file remaps
+    CTFileStream strm;
+    strm.Open_t(fnmList);
+
+    while (!strm.AtEOF()) {
+      IData::GetLineFromStream_t(strm, strLine, 256);
+
+      // Skip lines without a pair of quoted files
+      if (sscanf(strLine, "\"%[^\"]\" \"%[^\"]\"", strSource, strRemap) != 2) continue;
+
+      // Skip remapping to itself
+      if (CTString(strSource) == strRemap) continue;
+
+      FileReplacement &fr = _aFileReplacements.Push();
+      fr.fr_strSource = strSource;
+      fr.fr_strReplacement = strRemap;
+    }
+
+  } catch (char *strError) {
+    (void)strError;
+  }
+
+  const INDEX ctReplacements = _aFileReplacements.Count();
+
+  // Keep the table at most half full
+  INDEX ctSlots = 16;
+  while (ctSlots < ctReplacements * 2) ctSlots <<= 1;
+
+  _aiReplacementIndex.New(ctSlots);
+
+  for (INDEX iSlot = 0; iSlot < ctSlots; iSlot++) {
+    _aiReplacementIndex[iSlot] = -1;
+  }
+
+  const ULONG ulMask = ctSlots - 1;
+
+  for (INDEX i = 0; i < ctReplacements; i++) {
+    const CTString &strSource = _aFileReplacements[i].fr_strSource;
+    ULONG ulSlot = IHash::StringNoCase(strSource.str_String) & ulMask;
+
+    // Find a free slot
+    for (; _aiReplacementIndex[ulSlot] != -1; ulSlot = (ulSlot + 1) & ulMask) {
+      // Earlier lines have priority over the same files later on
+      if (_aFileReplacements[_aiReplacementIndex[ulSlot]].fr_strSource == strSource) break;
+    }
+
+    if (_aiReplacementIndex[ulSlot] == -1) {
+      _aiReplacementIndex[ulSlot] = i;
+    }
+  }
+};
+
+// [Cecil] Find replacement for a file in the list of base replacements
+BOOL FindFileReplacement(const CTFileName &fnmSource, CTFileName &fnmReplacement)
+{
+  const CTFileName fnmList = CTString("Data\\BaseForReplacingFiles.txt");
+
+  // Reparse the list if it has been changed or overridden since the last time
+  CTString strPath;
+  SQUAD llVersion;
+  GetReplacementsVersion(fnmList, strPath, llVersion);
+
+  if (_aiReplacementIndex.Count() == 0 || llVersion != _llReplacementsVersion || strPath != _strReplacementsPath) {
+    LoadFileReplacements(fnmList);
+
+    _strReplacementsPath = strPath;
+    _llReplacementsVersion = llVersion;
+  }
+
+  const ULONG ulMask = _aiReplacementIndex.Count() - 1;
+  ULONG ulSlot = IHash::StringNoCase(fnmSource.str_String) & ulMask;
+
+  // Go through occupied slots until the file is found
+  for (; _aiReplacementIndex[ulSlot] != -1; ulSlot = (ulSlot + 1) & ulMask) {
+    const FileReplacement &fr = _aFileReplacements[_aiReplacementIndex[ulSlot]];
+
+    if (fr.fr_strSource == fnmSource) {
+      fnmReplacement = fr.fr_strReplacement;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+};
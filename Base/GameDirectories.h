@@ -72,4 +72,8 @@ CORE_API void ListInDir(const CTFileName &fnmBaseDir, CFileList &afnm,
 // List files from a specific game directory
 CORE_API void ListGameFiles(CFileList &afnmFiles, const CTString &strDir, const CTString &strPattern, ULONG ulFlags);
 
+// [Cecil] Find replacement for a file in the list of base replacements
+// The list is parsed once and reparsed only after the file changes
+CORE_API BOOL FindFileReplacement(const CTFileName &fnmSource, CTFileName &fnmReplacement);
+
 #endif
@@ -16,6 +16,16 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "StdH.h"
 
 #include "Unzip.h"
+#include "Interfaces/HashFunctions.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
 
 // Include zlib
 #include <Extras/zlib/zlib.h>
@@ -101,18 +111,20 @@ struct EndOfDir {
 #define BUF_SIZE 1024
 
 // An open instance of a file inside a zip
+// [Cecil] NOTE: The layout must stay the same as in the engine because the engine still reads
+// entries of open handles on its own (e.g. in UNZIPGetFileInfo()); decompression happens
+// in a separate CZipHandleState instead
 class CZipHandle {
   public:
     BOOL zh_bOpen;        // Set if the handle is used
     CZipEntry zh_zeEntry; // The entry itself
-    z_stream zh_zstream;  // zlib filestream for decompression
-    FILE *zh_fFile;       // Open handle of the archive
-    UBYTE *zh_pubBufIn;   // Input buffer
+    z_stream zh_zstream;  // Unused (see CZipHandleState)
+    FILE *zh_fFile;       // Unused (see CZipHandleState)
+    UBYTE *zh_pubBufIn;   // Unused (see CZipHandleState)
     
   public:
     CZipHandle();
     void Clear(void);
-    void Throw_t(int iErr, const CTString &strDescription);
 };
 
 CZipHandle::CZipHandle(void)
@@ -128,332 +140,1681 @@ void CZipHandle::Clear(void)
 {
   zh_bOpen = FALSE;
   zh_zeEntry.Clear();
+};
 
-  // Clear the zlib stream
-  CTSingleLock slZip(_pcsZipLock, TRUE);
+// [Cecil] Pointer to '_azhHandles' in the engine
+static CStaticStackArray<CZipHandle> &_aZipHandles = *(CStaticStackArray<CZipHandle> *)ADDR_UNZIP_HANDLES;
 
-  inflateEnd(&zh_zstream);
-  memset(&zh_zstream, 0, sizeof(zh_zstream));
+// [Cecil] Inflate state checkpoints require zlib 1.2.0+ for inflateCopy()
+#if defined(ZLIB_VERNUM) && ZLIB_VERNUM >= 0x1200
+  #define ZIP_SEEK_CHECKPOINTS 1
+#else
+  #define ZIP_SEEK_CHECKPOINTS 0
+  #pragma message("zlib " ZLIB_VERSION " has no inflateCopy(), so inflate checkpoints are disabled and backward seeks in deflated entries restart from the beginning")
+#endif
 
-  // Free buffers
-  if (zh_pubBufIn != NULL) {
-    FreeMemory(zh_pubBufIn);
-    zh_pubBufIn = NULL;
-  }
+// [Cecil] Approximate memory used by one checkpoint (inflate state with a full window)
+#define ZIP_CHECKPOINT_COST (40 * 1024)
 
-  // Close the zip archive file
-  if (zh_fFile != NULL) {
-    fclose(zh_fFile);
-    zh_fFile = NULL;
+// [Cecil] Size of the buffer for skipping decompressed data
+#define ZIP_SCRATCH_SIZE (32 * 1024)
+
+// [Cecil] Distance between inflate checkpoints in deflated entries (in KB, 0 to disable)
+static INDEX fil_iZipCheckpointKB = 256;
+
+// [Cecil] Maximum memory for inflate checkpoints of one open entry (in KB)
+static INDEX fil_iZipCheckpointBudgetKB = 4096;
+
+// [Cecil] Keep small entries fully decompressed in memory after opening them
+static INDEX fil_bZipEntryCache = FALSE;
+
+// [Cecil] Maximum size of an entry that can be cached (in KB)
+static INDEX fil_iZipCacheEntryKB = 64;
+
+// [Cecil] Maximum memory for all cached entries (in KB)
+static INDEX fil_iZipCacheBudgetKB = 8192;
+
+// [Cecil] Entry cache statistics
+static INDEX fil_ctZipCacheHits = 0;
+static INDEX fil_ctZipCacheMisses = 0;
+static INDEX fil_ctZipCacheEntries = 0;
+static INDEX fil_iZipCacheUsedKB = 0;
+
+// [Cecil] Fully decompressed entry in the cache
+struct ZipCachedEntry {
+  CListNode zce_lnInLRU;  // Node in the list of cached entries (most recently used first)
+  INDEX zce_iFile;        // Index of the entry in '_aZipFiles' (-1 if evicted)
+  SLONG zce_slDataOffset; // Exact data offset of the entry
+  SLONG zce_slSize;       // Size of decompressed data
+  UBYTE *zce_pubData;     // Decompressed data
+  INDEX zce_ctRefs;       // Amount of open handles that are reading this data
+};
+
+static CTCriticalSection _csZipCache;
+static CListHead _lhZipCache;
+static CStaticArray<ZipCachedEntry *> _apZipCached; // Cached data under each file index
+static SLONG _slZipCacheSize = 0;
+
+static void FreeCachedEntry(ZipCachedEntry *pzce)
+{
+  FreeMemory(pzce->zce_pubData);
+  delete pzce;
+};
+
+static void UpdateCacheStats(void)
+{
+  fil_ctZipCacheEntries = _lhZipCache.Count();
+  fil_iZipCacheUsedKB = (_slZipCacheSize + 1023) / 1024;
+};
+
+// Remove entry from the cache (it's freed once the last handle stops reading it)
+static void EvictCachedEntry(ZipCachedEntry *pzce)
+{
+  pzce->zce_lnInLRU.Remove();
+  _apZipCached[pzce->zce_iFile] = NULL;
+  _slZipCacheSize -= pzce->zce_slSize;
+
+  pzce->zce_iFile = -1;
+
+  if (pzce->zce_ctRefs == 0) {
+    FreeCachedEntry(pzce);
   }
 };
 
-void CZipHandle::Throw_t(int iErr, const CTString &strDescription) {
-  CTString strError;
+// Remove all entries from the cache
+static void FlushEntryCache(void)
+{
+  CTSingleLock slCache(&_csZipCache, TRUE);
 
-  switch (iErr) {
-    case Z_OK:            strError = "Z_OK           "; break;
-    case Z_STREAM_END:    strError = "Z_STREAM_END   "; break;
-    case Z_NEED_DICT:     strError = "Z_NEED_DICT    "; break;
-    case Z_STREAM_ERROR:  strError = "Z_STREAM_ERROR "; break;
-    case Z_DATA_ERROR:    strError = "Z_DATA_ERROR   "; break;
-    case Z_MEM_ERROR:     strError = "Z_MEM_ERROR    "; break;
-    case Z_BUF_ERROR:     strError = "Z_BUF_ERROR    "; break;
-    case Z_VERSION_ERROR: strError = "Z_VERSION_ERROR"; break;
-    case Z_ERRNO: strError.PrintF("Z_ERRNO: %s", strerror(errno)); break;
-    default: strError.PrintF(LOCALIZE("Unknown ZLIB error: %d"), iErr);
+  while (!_lhZipCache.IsEmpty()) {
+    EvictCachedEntry(LIST_HEAD(_lhZipCache, ZipCachedEntry, zce_lnInLRU));
   }
 
-  ThrowF_t(LOCALIZE("(%s/%s) %s - ZLIB error: %s - %s"), zh_zeEntry.ze_pfnmArchive->str_String,
-    zh_zeEntry.ze_fnm.str_String, strDescription, strError.str_String, zh_zstream.msg);
+  _apZipCached.Clear();
+  UpdateCacheStats();
 };
 
-// [Cecil] Pointer to '_azhHandles' in the engine
-static CStaticStackArray<CZipHandle> &_aZipHandles = *(CStaticStackArray<CZipHandle> *)ADDR_UNZIP_HANDLES;
+// Check if some entry can be cached
+static BOOL IsEntryCacheable(const CZipEntry &ze)
+{
+  if (!fil_bZipEntryCache) return FALSE;
 
-// [Cecil] Pointer to '_azeFiles' in the engine
-static CStaticStackArray<CZipEntry> &_aZipFiles = *(CStaticStackArray<CZipEntry> *)ADDR_UNZIP_ENTRIES;
+  const SLONG slMaxSize = Min(fil_iZipCacheEntryKB, fil_iZipCacheBudgetKB) * 1024;
+  return (ze.ze_slUncompressedSize > 0 && ze.ze_slUncompressedSize <= slMaxSize);
+};
 
-// [Cecil] Pointer to '_afnmArchives' in the engine
-static CStaticStackArray<CTFileName> &_aZipArchives = *(CStaticStackArray<CTFileName> *)ADDR_UNZIP_ARCHIVES;
+// Start reading cached data of some entry (NULL if not cached)
+static ZipCachedEntry *AcquireCachedEntry(INDEX iFile)
+{
+  CTSingleLock slCache(&_csZipCache, TRUE);
 
-// [Cecil] Handle verification (to avoid code duplication)
-static inline BOOL VerifyHandle(INDEX iHandle) {
-  // Check handle number
-  if (iHandle < 0 || iHandle >= _aZipHandles.Count()) {
-    ASSERT(FALSE);
-    return FALSE;
+  // Reset the cache if the list of files has changed
+  if (_apZipCached.Count() != _aZipFiles.Count()) {
+    FlushEntryCache();
+
+    const INDEX ctFiles = _aZipFiles.Count();
+    _apZipCached.New(ctFiles);
+
+    for (INDEX i = 0; i < ctFiles; i++) {
+      _apZipCached[i] = NULL;
+    }
   }
 
-  // Check the handle
-  CZipHandle &zh = _aZipHandles[iHandle];
+  ZipCachedEntry *pzce = _apZipCached[iFile];
 
-  if (!zh.zh_bOpen) {
-    ASSERT(FALSE);
-    return FALSE;
+  if (pzce == NULL) {
+    fil_ctZipCacheMisses++;
+    return NULL;
   }
 
-  return TRUE;
-};
+  fil_ctZipCacheHits++;
 
-namespace IUnzip {
+  // Mark as the most recently used
+  pzce->zce_lnInLRU.Remove();
+  _lhZipCache.AddHead(pzce->zce_lnInLRU);
 
-// [Cecil] Get priority for a specific archive
-static INDEX ArchiveDirPriority(CTFileName fnm)
+  pzce->zce_ctRefs++;
+  return pzce;
+};
+
+// Put decompressed data of some entry into the cache and start reading it
+static ZipCachedEntry *AddCachedEntry(INDEX iFile, SLONG slDataOffset, UBYTE *pubData, SLONG slSize)
 {
-  #define PRI_MOD   103
-  #define PRI_CDMOD 102
-  #define PRI_EXTRA 101
-  #define PRI_GAME  100
-  #define PRI_CD   -100 // Absolute last resort
+  CTSingleLock slCache(&_csZipCache, TRUE);
 
-  // Current game (overrides other games and CD)
-  if (fnm.RemovePrefix(IDir::AppPath())) {
-    // Check for mod (overrides everything)
-    return fnm.HasPrefix("Mods\\") ? PRI_MOD : PRI_GAME;
+  // List of files has changed since the entry was opened
+  if (iFile >= _apZipCached.Count()) {
+    FreeMemory(pubData);
+    return NULL;
+  }
 
-  // CD path
-  } else if (_fnmCDPath != "" && fnm.RemovePrefix(_fnmCDPath)) {
-    // Check for CD mod (overrides everything but normal mod)
-    return fnm.HasPrefix("Mods\\") ? PRI_CDMOD : PRI_CD;
+  ZipCachedEntry *pzce = _apZipCached[iFile];
+
+  // Already cached by another handle
+  if (pzce != NULL) {
+    FreeMemory(pubData);
+
+    pzce->zce_ctRefs++;
+    return pzce;
   }
 
-  // Other game paths
-  for (INDEX iDir = 0; iDir < GAME_DIRECTORIES_CT; iDir++) {
-    const CTString &strDir = _astrGameDirs[iDir];
+  pzce = new ZipCachedEntry;
+  pzce->zce_iFile = iFile;
+  pzce->zce_slDataOffset = slDataOffset;
+  pzce->zce_slSize = slSize;
+  pzce->zce_pubData = pubData;
+  pzce->zce_ctRefs = 1;
 
-    if (strDir != "" && fnm.HasPrefix(strDir)) {
-      // Sort by list index (doesn't override other files)
-      return iDir;
-    }
+  _lhZipCache.AddHead(pzce->zce_lnInLRU);
+  _apZipCached[iFile] = pzce;
+  _slZipCacheSize += slSize;
+
+  // Evict least recently used entries that don't fit into the budget
+  const SLONG slBudget = ClampDn(fil_iZipCacheBudgetKB, (INDEX)0) * 1024;
+
+  while (_slZipCacheSize > slBudget) {
+    ZipCachedEntry *pzceLast = LIST_TAIL(_lhZipCache, ZipCachedEntry, zce_lnInLRU);
+    if (pzceLast == pzce) break;
+
+    EvictCachedEntry(pzceLast);
   }
 
-  // None of the above - extra content directory (overrides current game)
-  return PRI_EXTRA;
+  UpdateCacheStats();
+  return pzce;
 };
 
-// [Cecil] Compare two ZIP file entries
-static int qsort_CompareContentDir(const void *pElement1, const void *pElement2)
+// Stop reading cached data
+static void ReleaseCachedEntry(ZipCachedEntry *pzce)
 {
-  // Get the entries
-  const CZipEntry &ze1 = *(const CZipEntry *)pElement1;
-  const CZipEntry &ze2 = *(const CZipEntry *)pElement2;
+  CTSingleLock slCache(&_csZipCache, TRUE);
 
-  // Sort archive directories with priority
-  INDEX iPriority1 = ArchiveDirPriority(*ze1.ze_pfnmArchive);
-  INDEX iPriority2 = ArchiveDirPriority(*ze2.ze_pfnmArchive);
+  ASSERT(pzce->zce_ctRefs > 0);
+  pzce->zce_ctRefs--;
 
-  if (iPriority1 < iPriority2) {
-    return +1;
-  } else if (iPriority1 > iPriority2) {
-    return -1;
+  // Free if it has been evicted already
+  if (pzce->zce_ctRefs == 0 && pzce->zce_iFile == -1) {
+    FreeCachedEntry(pzce);
   }
-
-  // Sort archives in reverse alphabetical order
-  return -stricmp(ze1.ze_pfnmArchive->str_String, ze2.ze_pfnmArchive->str_String);
 };
 
-// [Cecil] Sort files in ZIP archives by content directory
-void SortEntries(void) {
-  // Order of archives after sorting:
-  // 1. From mod
-  // 2. From mod on CD
-  // 3. From extra content directories
-  // 4. From the game itself
-  // 5. From other game directories
-  // 6. From CD
-  qsort(&_aZipFiles[0], _aZipFiles.Count(), sizeof(CZipEntry), qsort_CompareContentDir);
+// [Cecil] Read entries directly from archives mapped into memory
+static INDEX fil_bZipMapArchives = TRUE;
+
+// [Cecil] Maximum address space for all mapped archives (in MB)
+// Archives that aren't being read stay mapped until they are the least recently used ones over the budget
+static INDEX fil_iZipMapBudgetMB = 256;
+
+// [Cecil] Read-only mapping of an entire file
+struct ZipFileMapping {
+  UBYTE *zfm_pubData; // Contents of the file
+  SLONG zfm_slSize;   // Size of the file
+
+#ifdef _WIN32
+  HANDLE zfm_hFile;
+  HANDLE zfm_hMapping;
+#endif
 };
 
-// Add one zip archive to the currently active set
-void AddArchive(const CTFileName &fnm)
+static void UnmapArchiveFile(ZipFileMapping &zfm)
 {
-  _aZipArchives.Push() = fnm;
+#ifdef _WIN32
+  if (zfm.zfm_pubData  != NULL) UnmapViewOfFile(zfm.zfm_pubData);
+  if (zfm.zfm_hMapping != NULL) CloseHandle(zfm.zfm_hMapping);
+  if (zfm.zfm_hFile != INVALID_HANDLE_VALUE) CloseHandle(zfm.zfm_hFile);
+
+  zfm.zfm_hFile = INVALID_HANDLE_VALUE;
+  zfm.zfm_hMapping = NULL;
+
+#else
+  if (zfm.zfm_pubData != NULL) munmap(zfm.zfm_pubData, zfm.zfm_slSize);
+#endif
+
+  zfm.zfm_pubData = NULL;
+  zfm.zfm_slSize = 0;
 };
 
-// Read directory of a zip archive and add all files in it to active set
-static void ReadZIPDirectory_t(CTFileName *pfnmZip)
+// Map some file no bigger than the limit (returns FALSE if the file should be read normally)
+static BOOL MapArchiveFile(const char *strFile, SLONG slMaxSize, ZipFileMapping &zfm)
 {
-  char *strZip = pfnmZip->str_String;
+  zfm.zfm_pubData = NULL;
+  zfm.zfm_slSize = 0;
 
-  // Open the archive
-  FILE *f = fopen(strZip, "rb");
+#ifdef _WIN32
+  zfm.zfm_hMapping = NULL;
+  zfm.zfm_hFile = CreateFileA(strFile, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
 
-  if (f == NULL) {
-    ThrowF_t(LOCALIZE("%s: Cannot open file (%s)"), strZip, strerror(errno));
+  if (zfm.zfm_hFile == INVALID_HANDLE_VALUE) return FALSE;
+
+  DWORD dwSizeHigh = 0;
+  const DWORD dwSize = GetFileSize(zfm.zfm_hFile, &dwSizeHigh);
+
+  if (dwSize == 0 || dwSize == INVALID_FILE_SIZE || dwSizeHigh != 0 || dwSize > (DWORD)slMaxSize) {
+    UnmapArchiveFile(zfm);
+    return FALSE;
   }
 
-  // Start at the end of file, minus expected minimum overhead
-  fseek(f, 0, SEEK_END);
+  zfm.zfm_hMapping = CreateFileMappingA(zfm.zfm_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+
+  if (zfm.zfm_hMapping != NULL) {
+    zfm.zfm_pubData = (UBYTE *)MapViewOfFile(zfm.zfm_hMapping, FILE_MAP_READ, 0, 0, 0);
+  }
+
+  zfm.zfm_slSize = dwSize;
+
+#else
+  const int iFile = open(strFile, O_RDONLY);
+  if (iFile == -1) return FALSE;
 
-  int iPos = ftell(f) - sizeof(long) - sizeof(EndOfDir) + 2;
+  struct stat statFile;
 
-  // Do not search more than 128k (should be around 65k at most)
-  int iMinPos = iPos - 128 * 1024;
+  if (fstat(iFile, &statFile) == 0 && statFile.st_size > 0 && statFile.st_size <= slMaxSize) {
+    void *pMapping = mmap(NULL, statFile.st_size, PROT_READ, MAP_PRIVATE, iFile, 0);
 
-  if (iMinPos < 0) {
-    iMinPos = 0;
+    if (pMapping != MAP_FAILED) {
+      zfm.zfm_pubData = (UBYTE *)pMapping;
+      zfm.zfm_slSize = statFile.st_size;
+    }
   }
 
-  EndOfDir eod;
-  BOOL bEODFound = FALSE;
+  // Mapping stays valid without the descriptor
+  close(iFile);
+#endif
+
+  if (zfm.zfm_pubData == NULL) {
+    UnmapArchiveFile(zfm);
+    return FALSE;
+  }
+
+  return TRUE;
+};
 
-  // While not at the beginning
-  for (; iPos > iMinPos; iPos--) {
-    // Read signature
-    fseek(f, iPos, SEEK_SET);
+// [Cecil] Archive that is shared between all handles reading from it
+struct ZipMappedArchive {
+  CListNode zma_lnInLRU;    // Node in the list of known archives (most recently used first)
+  CTString zma_strArchive;  // Path to the archive
+  ZipFileMapping zma_zfm;   // Mapping of the archive (no data if it cannot be mapped)
+  INDEX zma_ctRefs;         // Amount of open handles that are reading from the archive
+  BOOL zma_bDetached;       // Removed from the list
+};
 
-    int iSignature;
-    fread(&iSignature, sizeof(iSignature), 1, f);
+static CTCriticalSection _csZipMappings;
+static CListHead _lhZipMappings;
+static SLONG _slZipMappedSize = 0;
+static SLONG _slZipMapBudget = -1; // Budget that known archives have been mapped under
 
-    // Found the signature
-    if (iSignature == SIGNATURE_EOD) {
-      // Read directory end
-      fread(&eod, sizeof(eod), 1, f);
+static void FreeArchiveMapping(ZipMappedArchive *pzma)
+{
+  _slZipMappedSize -= pzma->zma_zfm.zfm_slSize;
 
-      // Cannot have a multi-volume zip
-      if (eod.eod_swDiskNo != 0 || eod.eod_swDirStartDiskNo != 0
-       || eod.eod_swEntriesInDirOnThisDisk != eod.eod_swEntriesInDir) {
-        ThrowF_t(LOCALIZE("%s: Multi-volume zips are not supported"), strZip);
-      }
+  UnmapArchiveFile(pzma->zma_zfm);
+  delete pzma;
+};
 
-      // Cannot have an empty zip
-      if (eod.eod_swEntriesInDir <= 0) {
-        ThrowF_t(LOCALIZE("%s: Empty zip"), strZip);
-      }
+// Forget the archive (it's unmapped once the last handle stops reading from it)
+static void DetachArchiveMapping(ZipMappedArchive *pzma)
+{
+  pzma->zma_lnInLRU.Remove();
+  pzma->zma_bDetached = TRUE;
 
-      bEODFound = TRUE;
-      break;
-    }
+  if (pzma->zma_ctRefs == 0) {
+    FreeArchiveMapping(pzma);
   }
+};
 
-  // EOD is not found
-  if (!bEODFound) {
-    ThrowF_t(LOCALIZE("%s: Cannot find 'end of central directory'"), strZip);
+// Forget all archives
+static void FlushArchiveMappings(void)
+{
+  CTSingleLock slMappings(&_csZipMappings, TRUE);
+
+  while (!_lhZipMappings.IsEmpty()) {
+    DetachArchiveMapping(LIST_HEAD(_lhZipMappings, ZipMappedArchive, zma_lnInLRU));
   }
+};
 
-  // Check if the zip is from a mod
-  BOOL bMod = pfnmZip->HasPrefix(IDir::AppPath() + "Mods\\")
-           || pfnmZip->HasPrefix(_fnmCDPath + "Mods\\");
+// Unmap least recently used archives that aren't being read until the rest fit into the size
+static void EvictArchiveMappings(SLONG slFitSize)
+{
+  while (_slZipMappedSize > slFitSize) {
+    ZipMappedArchive *pzmaLast = NULL;
 
-  // Go to the beginning of the central dir
-  fseek(f, eod.eod_slDirOffsetInFile, SEEK_SET);
+    {FOREACHINLIST(ZipMappedArchive, zma_lnInLRU, _lhZipMappings, itzma) {
+      if (itzma->zma_ctRefs == 0 && itzma->zma_zfm.zfm_pubData != NULL) {
+        pzmaLast = itzma;
+      }
+    }}
 
-  INDEX ctFiles = 0;
+    // Everything else is being read
+    if (pzmaLast == NULL) return;
 
-  // For each file
-  for (INDEX iFile = 0; iFile < eod.eod_swEntriesInDir; iFile++) {
-    // Read the signature
-    int slSig;
-    fread(&slSig, sizeof(slSig), 1, f);
+    DetachArchiveMapping(pzmaLast);
+  }
+};
 
-    // Unexpected signature
-    if (slSig != SIGNATURE_FH) {
-      ThrowF_t(LOCALIZE("%s: Wrong signature for 'file header' number %d'"), strZip, iFile);
+// Forget archives that couldn't be mapped, so they are tried again
+static void ForgetUnmappedArchives(void)
+{
+  {FORDELETELIST(ZipMappedArchive, zma_lnInLRU, _lhZipMappings, itzma) {
+    if (itzma->zma_zfm.zfm_pubData == NULL) {
+      DetachArchiveMapping(itzma);
     }
+  }}
+};
 
-    // Read its header
-    FileHeader fh;
-    fread(&fh, sizeof(fh), 1, f);
+// Start reading from the mapping of some archive (NULL if it should be read normally)
+static ZipMappedArchive *AcquireArchiveMapping(const CTFileName &fnmArchive)
+{
+  if (!fil_bZipMapArchives) return NULL;
 
-    // Check the filename
-    const SLONG slMaxFileName = 512;
+  CTSingleLock slMappings(&_csZipMappings, TRUE);
 
-    if (fh.fh_swFileNameLen > slMaxFileName) {
-      ThrowF_t(LOCALIZE("%s: Too long filepath in zip"), strZip);
+  const SLONG slBudget = Clamp(fil_iZipMapBudgetMB, (INDEX)0, (INDEX)2047) * 1024 * 1024;
+
+  // Archives that didn't fit before may fit now and the mapped ones may not fit anymore
+  if (_slZipMapBudget != slBudget) {
+    _slZipMapBudget = slBudget;
+
+    ForgetUnmappedArchives();
+    EvictArchiveMappings(slBudget);
+  }
+
+  ZipMappedArchive *pzma = NULL;
+
+  {FOREACHINLIST(ZipMappedArchive, zma_lnInLRU, _lhZipMappings, itzma) {
+    if (itzma->zma_strArchive == fnmArchive) {
+      pzma = itzma;
+      break;
     }
+  }}
 
-    if (fh.fh_swFileNameLen <= 0) {
-      ThrowF_t(LOCALIZE("%s: Invalid filepath length in zip"), strZip);
+  // Map the archive for the first time
+  if (pzma == NULL) {
+    // Make room for it by unmapping archives that aren't being read
+    struct _stati64 st;
+
+    if (_stati64(fnmArchive.str_String, &st) == 0 && st.st_size <= slBudget) {
+      EvictArchiveMappings(slBudget - (SLONG)st.st_size);
     }
-    
-    // Read the filename
-    char strBuffer[slMaxFileName + 1];
-    memset(strBuffer, 0, sizeof(strBuffer));
 
-    fread(strBuffer, fh.fh_swFileNameLen, 1, f);
+    ZipFileMapping zfm;
+    MapArchiveFile(fnmArchive.str_String, slBudget, zfm);
 
-    // Skip eventual comment and extra fields
-    if (fh.fh_swFileCommentLen + fh.fh_swExtraFieldLen > 0) {
-      fseek(f, fh.fh_swFileCommentLen+fh.fh_swExtraFieldLen, SEEK_CUR);
+    // Try again later if other archives are being read from right now
+    if (zfm.zfm_slSize > slBudget - _slZipMappedSize) {
+      UnmapArchiveFile(zfm);
+      return NULL;
     }
 
-    // If it's a directory
-    if (strBuffer[strlen(strBuffer) - 1] == '/') {
-      // Check the size
-      if (fh.fh_slUncompressedSize != 0 || fh.fh_slCompressedSize != 0) {
-        ThrowF_t(LOCALIZE("%s/%s: Invalid directory"), strZip, strBuffer);
-      }
+    pzma = new ZipMappedArchive;
+    pzma->zma_strArchive = fnmArchive;
+    pzma->zma_zfm = zfm;
+    pzma->zma_ctRefs = 0;
+    pzma->zma_bDetached = FALSE;
 
-    // If it's a file
-    } else {
-      ctFiles++;
+    _slZipMappedSize += zfm.zfm_slSize;
 
-      // Convert slashes in the filename
-      IData::ReplaceChar(strBuffer, '/', '\\');
+  } else {
+    pzma->zma_lnInLRU.Remove();
+  }
 
-      // Create a new entry
-      CZipEntry &ze = _aZipFiles.Push();
+  // Mark as the most recently used
+  _lhZipMappings.AddHead(pzma->zma_lnInLRU);
 
-      // Remember file data
-      ze.ze_fnm = CTString(strBuffer);
-      ze.ze_pfnmArchive = pfnmZip;
-      ze.ze_slCompressedSize = fh.fh_slCompressedSize;
-      ze.ze_slUncompressedSize = fh.fh_slUncompressedSize;
-      ze.ze_slDataOffset = fh.fh_slLocalHeaderOffset;
-      ze.ze_ulCRC = fh.fh_slCRC32;
+  // Cannot be mapped
+  if (pzma->zma_zfm.zfm_pubData == NULL) return NULL;
 
-      #if SE1_GAME != SS_REV
-        ze.ze_bMod = bMod;
-      #endif
+  pzma->zma_ctRefs++;
+  return pzma;
+};
 
-      // Check for compressopn
-      if (fh.fh_swCompressionMethod == 0) {
-        ze.ze_bStored = TRUE;
+// Stop reading from the mapping
+static void ReleaseArchiveMapping(ZipMappedArchive *pzma)
+{
+  CTSingleLock slMappings(&_csZipMappings, TRUE);
+
+  ASSERT(pzma->zma_ctRefs > 0);
+  pzma->zma_ctRefs--;
+
+  // Keep the archive mapped for the next handles unless it has been forgotten
+  if (pzma->zma_ctRefs == 0 && pzma->zma_bDetached) {
+    FreeArchiveMapping(pzma);
+  }
+};
+
+// [Cecil] Decompression state of an open handle
+// Allocated separately for each handle, so it stays in place while the handle array is being
+// expanded and can be used under its own lock without blocking reads from other handles
+class CZipHandleState {
+  public:
+    CTCriticalSection zhs_csLock; // Lock for reading from this handle
+    CZipEntry zhs_zeEntry;        // Copy of the entry with exact data offset
+    z_stream zhs_zstream;         // zlib filestream for decompression
+    FILE *zhs_fFile;              // Own handle of the archive
+    ZipMappedArchive *zhs_pMapping; // Mapped archive (replaces the file handle)
+    UBYTE *zhs_pubBufIn;          // Input buffer
+    UBYTE *zhs_pubScratch;        // Buffer for skipping decompressed data
+    ZipCachedEntry *zhs_pCached;  // Decompressed data from the entry cache (replaces the stream)
+
+    z_stream *zhs_aCheckpoints; // Inflate states at increasing positions of decompressed data
+    INDEX zhs_ctCheckpoints;    // Amount of taken checkpoints
+    INDEX zhs_ctMaxCheckpoints; // Maximum amount of checkpoints within the memory budget
+    ULONG zhs_ulInterval;       // Distance between checkpoints
+    ULONG zhs_ulNextCheckpoint; // Decompressed position for the next checkpoint (0 if none)
+
+  public:
+    CZipHandleState();
+    ~CZipHandleState();
+
+    void Clear(void);
+
+    // Release the archive file and the decompression stream
+    void ReleaseStream(void);
+
+    // Read raw data from the archive
+    BOOL ReadArchive(SLONG slOffset, void *pDest, SLONG slSize);
+
+    // Start feeding compressed data to the stream from some position
+    void RewindInput(ULONG ulCompressedPos);
+
+    void Throw_t(int iErr, const CTString &strDescription);
+
+    // Remember current inflate state
+    void TakeCheckpoint(void);
+
+    // Find the last checkpoint at or before some decompressed position (-1 if none)
+    INDEX FindCheckpoint(ULONG ulPos) const;
+};
+
+CZipHandleState::CZipHandleState(void)
+{
+  zhs_fFile = NULL;
+  zhs_pMapping = NULL;
+  zhs_pubBufIn = NULL;
+  zhs_pubScratch = NULL;
+  zhs_pCached = NULL;
+
+  zhs_aCheckpoints = NULL;
+  zhs_ctCheckpoints = 0;
+  zhs_ctMaxCheckpoints = 0;
+  zhs_ulInterval = 0;
+  zhs_ulNextCheckpoint = 0;
+
+  memset(&zhs_zstream, 0, sizeof(zhs_zstream));
+};
+
+CZipHandleState::~CZipHandleState(void)
+{
+  Clear();
+};
+
+void CZipHandleState::Clear(void)
+{
+  zhs_zeEntry.Clear();
+
+  // Stop reading cached data
+  if (zhs_pCached != NULL) {
+    ReleaseCachedEntry(zhs_pCached);
+    zhs_pCached = NULL;
+  }
+
+  ReleaseStream();
+};
+
+void CZipHandleState::ReleaseStream(void)
+{
+  // Clear the zlib stream
+  inflateEnd(&zhs_zstream);
+  memset(&zhs_zstream, 0, sizeof(zhs_zstream));
+
+  // Free buffers
+  if (zhs_pubBufIn != NULL) {
+    FreeMemory(zhs_pubBufIn);
+    zhs_pubBufIn = NULL;
+  }
+
+  if (zhs_pubScratch != NULL) {
+    FreeMemory(zhs_pubScratch);
+    zhs_pubScratch = NULL;
+  }
+
+  // Release checkpoints
+  for (INDEX i = 0; i < zhs_ctCheckpoints; i++) {
+    inflateEnd(&zhs_aCheckpoints[i]);
+  }
+
+  if (zhs_aCheckpoints != NULL) {
+    FreeMemory(zhs_aCheckpoints);
+    zhs_aCheckpoints = NULL;
+  }
+
+  zhs_ctCheckpoints = 0;
+  zhs_ctMaxCheckpoints = 0;
+  zhs_ulInterval = 0;
+  zhs_ulNextCheckpoint = 0;
+
+  // Close the zip archive file
+  if (zhs_fFile != NULL) {
+    fclose(zhs_fFile);
+    zhs_fFile = NULL;
+  }
+
+  if (zhs_pMapping != NULL) {
+    ReleaseArchiveMapping(zhs_pMapping);
+    zhs_pMapping = NULL;
+  }
+};
+
+BOOL CZipHandleState::ReadArchive(SLONG slOffset, void *pDest, SLONG slSize)
+{
+  // Copy from the mapping
+  if (zhs_pMapping != NULL) {
+    const SLONG slMappingSize = zhs_pMapping->zma_zfm.zfm_slSize;
+
+    if (slOffset < 0 || slSize < 0 || slOffset > slMappingSize || slSize > slMappingSize - slOffset) {
+      return FALSE;
+    }
+
+    memcpy(pDest, zhs_pMapping->zma_zfm.zfm_pubData + slOffset, slSize);
+    return TRUE;
+  }
+
+  fseek(zhs_fFile, slOffset, SEEK_SET);
+  return ((SLONG)fread(pDest, 1, slSize, zhs_fFile) == slSize);
+};
+
+void CZipHandleState::RewindInput(ULONG ulCompressedPos)
+{
+  // Entire compressed data is available in the mapping
+  if (zhs_pMapping != NULL) {
+    zhs_zstream.next_in = zhs_pMapping->zma_zfm.zfm_pubData + zhs_zeEntry.ze_slDataOffset + ulCompressedPos;
+    zhs_zstream.avail_in = zhs_zeEntry.ze_slCompressedSize - ulCompressedPos;
+    return;
+  }
+
+  // Read it from the file later
+  zhs_zstream.next_in = NULL;
+  zhs_zstream.avail_in = 0;
+
+  fseek(zhs_fFile, zhs_zeEntry.ze_slDataOffset + ulCompressedPos, SEEK_SET);
+};
+
+void CZipHandleState::Throw_t(int iErr, const CTString &strDescription) {
+  CTString strError;
+
+  switch (iErr) {
+    case Z_OK:            strError = "Z_OK           "; break;
+    case Z_STREAM_END:    strError = "Z_STREAM_END   "; break;
+    case Z_NEED_DICT:     strError = "Z_NEED_DICT    "; break;
+    case Z_STREAM_ERROR:  strError = "Z_STREAM_ERROR "; break;
+    case Z_DATA_ERROR:    strError = "Z_DATA_ERROR   "; break;
+    case Z_MEM_ERROR:     strError = "Z_MEM_ERROR    "; break;
+    case Z_BUF_ERROR:     strError = "Z_BUF_ERROR    "; break;
+    case Z_VERSION_ERROR: strError = "Z_VERSION_ERROR"; break;
+    case Z_ERRNO: strError.PrintF("Z_ERRNO: %s", strerror(errno)); break;
+    default: strError.PrintF(LOCALIZE("Unknown ZLIB error: %d"), iErr);
+  }
+
+  ThrowF_t(LOCALIZE("(%s/%s) %s - ZLIB error: %s - %s"), zhs_zeEntry.ze_pfnmArchive->str_String,
+    zhs_zeEntry.ze_fnm.str_String, strDescription, strError.str_String, zhs_zstream.msg);
+};
+
+void CZipHandleState::TakeCheckpoint(void)
+{
+#if ZIP_SEEK_CHECKPOINTS
+  // Out of budget
+  if (zhs_ctCheckpoints >= zhs_ctMaxCheckpoints) {
+    zhs_ulNextCheckpoint = 0;
+    return;
+  }
+
+  // Already covered by the last checkpoint
+  if (zhs_ctCheckpoints > 0 && zhs_aCheckpoints[zhs_ctCheckpoints - 1].total_out >= zhs_zstream.total_out) {
+    return;
+  }
+
+  if (zhs_aCheckpoints == NULL) {
+    zhs_aCheckpoints = (z_stream *)AllocMemory(zhs_ctMaxCheckpoints * sizeof(z_stream));
+    memset(zhs_aCheckpoints, 0, zhs_ctMaxCheckpoints * sizeof(z_stream));
+  }
+
+  if (inflateCopy(&zhs_aCheckpoints[zhs_ctCheckpoints], &zhs_zstream) == Z_OK) {
+    zhs_ctCheckpoints++;
+  }
+
+  zhs_ulNextCheckpoint = zhs_zstream.total_out + zhs_ulInterval;
+#endif
+};
+
+INDEX CZipHandleState::FindCheckpoint(ULONG ulPos) const
+{
+  INDEX iMin = 0;
+  INDEX iMax = zhs_ctCheckpoints - 1;
+  INDEX iFound = -1;
+
+  while (iMin <= iMax) {
+    const INDEX iMid = (iMin + iMax) / 2;
+
+    if (zhs_aCheckpoints[iMid].total_out <= ulPos) {
+      iFound = iMid;
+      iMin = iMid + 1;
+    } else {
+      iMax = iMid - 1;
+    }
+  }
+
+  return iFound;
+};
+
+// [Cecil] Decompression states of each handle under the same index
+static CStaticStackArray<CZipHandleState *> _apZipHandleStates;
+
+// [Cecil] Pointer to '_azeFiles' in the engine
+static CStaticStackArray<CZipEntry> &_aZipFiles = *(CStaticStackArray<CZipEntry> *)ADDR_UNZIP_ENTRIES;
+
+// [Cecil] Pointer to '_afnmArchives' in the engine
+static CStaticStackArray<CTFileName> &_aZipArchives = *(CStaticStackArray<CTFileName> *)ADDR_UNZIP_ARCHIVES;
+
+// [Cecil] Handle verification (to avoid code duplication)
+static inline BOOL VerifyHandle(INDEX iHandle) {
+  // Check handle number
+  if (iHandle < 0 || iHandle >= _aZipHandles.Count()) {
+    ASSERT(FALSE);
+    return FALSE;
+  }
+
+  // Check the handle
+  CZipHandle &zh = _aZipHandles[iHandle];
+
+  if (!zh.zh_bOpen) {
+    ASSERT(FALSE);
+    return FALSE;
+  }
+
+  return TRUE;
+};
+
+// [Cecil] Hash table with indices of files in '_aZipFiles' for quick lookups by name
+static CStaticArray<INDEX> _aiFileIndex;
+
+// [Cecil] Amount of files at the moment of building the hash table (-1 if not built)
+static INDEX _ctIndexedFiles = -1;
+
+// [Cecil] Get case-insensitive hash of a file path regardless of slash direction
+static ULONG HashFilePath(const char *strPath)
+{
+  ULONG ulHash = IHash::ulInitial;
+
+  for (; *strPath != '\0'; strPath++) {
+    char ch = *strPath;
+    if (ch == '/') ch = '\\';
+
+    ulHash = IHash::CharNoCase(ulHash, ch);
+  }
+
+  return ulHash;
+};
+
+// [Cecil] Compare two file paths case-insensitively regardless of slash direction
+static BOOL SameFilePath(const char *strPath1, const char *strPath2)
+{
+  for (;; strPath1++, strPath2++) {
+    char ch1 = *strPath1;
+    char ch2 = *strPath2;
+
+    if (ch1 == '/') ch1 = '\\';
+    if (ch2 == '/') ch2 = '\\';
+
+    if (toupper((UBYTE)ch1) != toupper((UBYTE)ch2)) return FALSE;
+    if (ch1 == '\0') return TRUE;
+  }
+};
+
+// [Cecil] Indices of files in '_aZipFiles' sorted by directory and then by name
+static CStaticArray<INDEX> _aiDirIndex;
+
+// [Cecil] Amount of files at the moment of building the directory index (-1 if not built)
+static INDEX _ctDirIndexedFiles = -1;
+
+// [Cecil] Build hash table out of all currently read files
+static void BuildFileIndex(void)
+{
+  // Directory index is rebuilt on demand
+  _ctDirIndexedFiles = -1;
+
+  const INDEX ctFiles = _aZipFiles.Count();
+
+  // Keep the table at most half full
+  INDEX ctSlots = 64;
+  while (ctSlots < ctFiles * 2) ctSlots <<= 1;
+
+  _aiFileIndex.Clear();
+  _aiFileIndex.New(ctSlots);
+
+  for (INDEX iSlot = 0; iSlot < ctSlots; iSlot++) {
+    _aiFileIndex[iSlot] = -1;
+  }
+
+  const ULONG ulMask = ctSlots - 1;
+
+  for (INDEX iFile = 0; iFile < ctFiles; iFile++) {
+    const char *strFile = _aZipFiles[iFile].ze_fnm.str_String;
+    ULONG ulSlot = HashFilePath(strFile) & ulMask;
+
+    // Find a free slot
+    for (; _aiFileIndex[ulSlot] != -1; ulSlot = (ulSlot + 1) & ulMask) {
+      // Files that come first have priority over the same files from other archives
+      if (SameFilePath(_aZipFiles[_aiFileIndex[ulSlot]].ze_fnm.str_String, strFile)) break;
+    }
+
+    if (_aiFileIndex[ulSlot] == -1) {
+      _aiFileIndex[ulSlot] = iFile;
+    }
+  }
+
+  _ctIndexedFiles = ctFiles;
+};
+
+// [Cecil] Find index of a file entry with a specific name (-1 if no file)
+static INDEX FindFileIndex(const CTFileName &fnm)
+{
+  const INDEX ctFiles = _aZipFiles.Count();
+
+  // Hash table is outdated, look through all the files
+  if (_ctIndexedFiles != ctFiles) {
+    for (INDEX iFile = 0; iFile < ctFiles; iFile++) {
+      if (SameFilePath(_aZipFiles[iFile].ze_fnm.str_String, fnm.str_String)) {
+        return iFile;
+      }
+    }
+
+    return -1;
+  }
+
+  const ULONG ulMask = _aiFileIndex.Count() - 1;
+  ULONG ulSlot = HashFilePath(fnm.str_String) & ulMask;
+
+  // Go through occupied slots until the file is found
+  for (; _aiFileIndex[ulSlot] != -1; ulSlot = (ulSlot + 1) & ulMask) {
+    const INDEX iFile = _aiFileIndex[ulSlot];
+
+    if (SameFilePath(_aZipFiles[iFile].ze_fnm.str_String, fnm.str_String)) {
+      return iFile;
+    }
+  }
+
+  return -1;
+};
+
+// [Cecil] Get length of the directory part of a file path
+static INDEX FilePathDirLength(const char *strPath)
+{
+  INDEX ctDir = 0;
+
+  for (INDEX i = 0; strPath[i] != '\0'; i++) {
+    if (strPath[i] == '\\' || strPath[i] == '/') ctDir = i + 1;
+  }
+
+  return ctDir;
+};
+
+// [Cecil] Compare parts of two file paths case-insensitively regardless of slash direction
+static int CompareFilePaths(const char *strPath1, INDEX ct1, const char *strPath2, INDEX ct2)
+{
+  const INDEX ct = Min(ct1, ct2);
+
+  for (INDEX i = 0; i < ct; i++) {
+    char ch1 = strPath1[i];
+    char ch2 = strPath2[i];
+
+    if (ch1 == '/') ch1 = '\\';
+    if (ch2 == '/') ch2 = '\\';
+
+    const int iDiff = toupper((UBYTE)ch1) - toupper((UBYTE)ch2);
+    if (iDiff != 0) return iDiff;
+  }
+
+  return ct1 - ct2;
+};
+
+// [Cecil] Sort files by their directories first and then by their names
+static int qsort_DirIndex(const void *pElement1, const void *pElement2)
+{
+  const char *strFile1 = _aZipFiles[*(const INDEX *)pElement1].ze_fnm.str_String;
+  const char *strFile2 = _aZipFiles[*(const INDEX *)pElement2].ze_fnm.str_String;
+
+  const INDEX ctDir1 = FilePathDirLength(strFile1);
+  const INDEX ctDir2 = FilePathDirLength(strFile2);
+
+  const int iDirs = CompareFilePaths(strFile1, ctDir1, strFile2, ctDir2);
+  if (iDirs != 0) return iDirs;
+
+  const int iNames = CompareFilePaths(strFile1 + ctDir1, strlen(strFile1 + ctDir1), strFile2 + ctDir2, strlen(strFile2 + ctDir2));
+  if (iNames != 0) return iNames;
+
+  // Keep the original order of the same files
+  return *(const INDEX *)pElement1 - *(const INDEX *)pElement2;
+};
+
+// [Cecil] Build directory index out of all currently read files
+static void BuildDirIndex(void)
+{
+  const INDEX ctFiles = _aZipFiles.Count();
+
+  _aiDirIndex.Clear();
+  _ctDirIndexedFiles = ctFiles;
+
+  if (ctFiles == 0) return;
+
+  _aiDirIndex.New(ctFiles);
+
+  for (INDEX iFile = 0; iFile < ctFiles; iFile++) {
+    _aiDirIndex[iFile] = iFile;
+  }
+
+  qsort(&_aiDirIndex[0], ctFiles, sizeof(INDEX), qsort_DirIndex);
+};
+
+namespace IUnzip {
+
+// [Cecil] Get priority for a specific archive
+static INDEX ArchiveDirPriority(CTFileName fnm)
+{
+  #define PRI_MOD   103
+  #define PRI_CDMOD 102
+  #define PRI_EXTRA 101
+  #define PRI_GAME  100
+  #define PRI_CD   -100 // Absolute last resort
+
+  // Current game (overrides other games and CD)
+  if (fnm.RemovePrefix(IDir::AppPath())) {
+    // Check for mod (overrides everything)
+    return fnm.HasPrefix("Mods\\") ? PRI_MOD : PRI_GAME;
+
+  // CD path
+  } else if (_fnmCDPath != "" && fnm.RemovePrefix(_fnmCDPath)) {
+    // Check for CD mod (overrides everything but normal mod)
+    return fnm.HasPrefix("Mods\\") ? PRI_CDMOD : PRI_CD;
+  }
+
+  // Other game paths
+  for (INDEX iDir = 0; iDir < GAME_DIRECTORIES_CT; iDir++) {
+    const CTString &strDir = _astrGameDirs[iDir];
+
+    if (strDir != "" && fnm.HasPrefix(strDir)) {
+      // Sort by list index (doesn't override other files)
+      return iDir;
+    }
+  }
+
+  // None of the above - extra content directory (overrides current game)
+  return PRI_EXTRA;
+};
+
+// [Cecil] Compare two ZIP file entries
+static int qsort_CompareContentDir(const void *pElement1, const void *pElement2)
+{
+  // Get the entries
+  const CZipEntry &ze1 = *(const CZipEntry *)pElement1;
+  const CZipEntry &ze2 = *(const CZipEntry *)pElement2;
+
+  // Sort archive directories with priority
+  INDEX iPriority1 = ArchiveDirPriority(*ze1.ze_pfnmArchive);
+  INDEX iPriority2 = ArchiveDirPriority(*ze2.ze_pfnmArchive);
+
+  if (iPriority1 < iPriority2) {
+    return +1;
+  } else if (iPriority1 > iPriority2) {
+    return -1;
+  }
+
+  // Sort archives in reverse alphabetical order
+  return -stricmp(ze1.ze_pfnmArchive->str_String, ze2.ze_pfnmArchive->str_String);
+};
+
+// [Cecil] Sort files in ZIP archives by content directory
+void SortEntries(void) {
+  // Order of archives after sorting:
+  // 1. From mod
+  // 2. From mod on CD
+  // 3. From extra content directories
+  // 4. From the game itself
+  // 5. From other game directories
+  // 6. From CD
+  if (_aZipFiles.Count() != 0) {
+    qsort(&_aZipFiles[0], _aZipFiles.Count(), sizeof(CZipEntry), qsort_CompareContentDir);
+  }
+
+  // [Cecil] Cached data is stored under file indices, which don't match the new order
+  FlushEntryCache();
+
+  // [Cecil] Rebuild hash table for the new order
+  BuildFileIndex();
+};
+
+// Add one zip archive to the currently active set
+void AddArchive(const CTFileName &fnm)
+{
+  _aZipArchives.Push() = fnm;
+};
+
+// [Cecil] Read data from a memory buffer within its bounds
+static inline BOOL ReadBufferData(const UBYTE *&pubData, const UBYTE *pubEnd, void *pDest, ULONG ulSize)
+{
+  if (ULONG(pubEnd - pubData) < ulSize) return FALSE;
+
+  memcpy(pDest, pubData, ulSize);
+  pubData += ulSize;
+  return TRUE;
+};
+
+// [Cecil] Central directory of one archive that's being read
+struct ZipDirTask {
+  CTFileName *zdt_pfnmZip; // Archive to read
+  SQUAD zdt_llSize;        // Archive file size (for the cache)
+  SQUAD zdt_llTime;        // Archive modification time (for the cache)
+  BOOL zdt_bCacheable;     // Set if archive stats have been retrieved
+  BOOL zdt_bScan;          // Set if the directory needs to be read from the archive
+
+  CStaticStackArray<CZipEntry> zdt_aEntries; // Read file entries
+  CTString zdt_strError; // Error that occurred while reading the directory
+
+  ZipDirTask() : zdt_pfnmZip(NULL), zdt_llSize(0), zdt_llTime(0), zdt_bCacheable(FALSE), zdt_bScan(FALSE) {};
+};
+
+// [Cecil] Zip64 end of central directory locator (right before the end of central directory)
+#define SIGNATURE_EOD64_LOCATOR 0x07064b50
+#define EOD64_LOCATOR_SIZE 20
+
+// [Cecil] Find and verify the end of central directory by scanning the tail of an archive in memory
+static BOOL FindEndOfDir(FILE *f, const char *strZip, EndOfDir &eod, CTString &strError)
+{
+  const SLONG slRecord = sizeof(ULONG) + sizeof(EndOfDir);
+
+  fseek(f, 0, SEEK_END);
+  const SLONG slFileSize = ftell(f);
+
+  // Too small to even fit the record
+  if (slFileSize < slRecord) {
+    strError.PrintF(LOCALIZE("%s: Cannot find 'end of central directory'"), strZip);
+    return FALSE;
+  }
+
+  // Read the tail that may contain the record and the longest possible comment
+  const SLONG slTail = Min(slFileSize, SLONG(slRecord + 0xFFFF));
+  const SLONG slTailStart = slFileSize - slTail;
+
+  UBYTE *pubTail = (UBYTE *)AllocMemory(slTail);
+  fseek(f, slTailStart, SEEK_SET);
+
+  if (fread(pubTail, slTail, 1, f) != 1) {
+    FreeMemory(pubTail);
+
+    strError.PrintF(LOCALIZE("%s: Error reading central directory"), strZip);
+    return FALSE;
+  }
+
+  SLONG slFound = -1;
+  SLONG slFallback = -1;
+
+  // Search backwards from the last possible position
+  for (SLONG slPos = slTail - slRecord; slPos >= 0; slPos--) {
+    // Quick check of the first signature byte
+    if (pubTail[slPos] != 'P') continue;
+
+    ULONG ulSignature;
+    memcpy(&ulSignature, pubTail + slPos, sizeof(ulSignature));
+
+    if (ulSignature != SIGNATURE_EOD) continue;
+
+    EndOfDir eodCheck;
+    memcpy(&eodCheck, pubTail + slPos + sizeof(ULONG), sizeof(EndOfDir));
+
+    const SLONG slRecordEnd = slPos + slRecord + (UWORD)eodCheck.eod_swCommentLenght;
+
+    // Comment ends exactly at the end of file, which means that it's a real record
+    // and not some signature that happens to be inside a comment of a real record
+    if (slRecordEnd == slTail) {
+      slFound = slPos;
+      break;
+    }
+
+    // Remember the last record that could've been followed by some junk data
+    if (slRecordEnd < slTail && slFallback == -1) {
+      slFallback = slPos;
+    }
+  }
+
+  if (slFound == -1) {
+    slFound = slFallback;
+  }
+
+  // EOD is not found
+  if (slFound == -1) {
+    FreeMemory(pubTail);
+
+    strError.PrintF(LOCALIZE("%s: Cannot find 'end of central directory'"), strZip);
+    return FALSE;
+  }
+
+  memcpy(&eod, pubTail + slFound + sizeof(ULONG), sizeof(EndOfDir));
+
+  // Check for the Zip64 locator
+  BOOL bZip64 = FALSE;
+
+  if (slFound >= EOD64_LOCATOR_SIZE) {
+    ULONG ulSignature;
+    memcpy(&ulSignature, pubTail + slFound - EOD64_LOCATOR_SIZE, sizeof(ulSignature));
+
+    bZip64 = (ulSignature == SIGNATURE_EOD64_LOCATOR);
+  }
+
+  FreeMemory(pubTail);
+
+  // Cannot have a Zip64 archive
+  if (bZip64 || (UWORD)eod.eod_swEntriesInDir == 0xFFFF
+   || (ULONG)eod.eod_slDirOffsetInFile == 0xFFFFFFFF || (ULONG)eod.eod_slSizeOfDir == 0xFFFFFFFF) {
+    strError.PrintF(TRANS("%s: Zip64 archives are not supported"), strZip);
+    return FALSE;
+  }
+
+  // Cannot have a multi-volume zip
+  if (eod.eod_swDiskNo != 0 || eod.eod_swDirStartDiskNo != 0
+   || eod.eod_swEntriesInDirOnThisDisk != eod.eod_swEntriesInDir) {
+    strError.PrintF(LOCALIZE("%s: Multi-volume zips are not supported"), strZip);
+    return FALSE;
+  }
+
+  // Cannot have an empty zip
+  if (eod.eod_swEntriesInDir == 0) {
+    strError.PrintF(LOCALIZE("%s: Empty zip"), strZip);
+    return FALSE;
+  }
+
+  // Central directory must be before its end
+  const SLONG slEODPos = slTailStart + slFound;
+
+  if (eod.eod_slDirOffsetInFile < 0 || eod.eod_slSizeOfDir < 0
+   || eod.eod_slDirOffsetInFile > slEODPos - eod.eod_slSizeOfDir) {
+    strError.PrintF(TRANS("%s: Truncated or corrupted central directory"), strZip);
+    return FALSE;
+  }
+
+  return TRUE;
+};
+
+// [Cecil] Decode central directory of an archive from memory
+static BOOL DecodeZIPDirectory(ZipDirTask &zdt, const UBYTE *pubDir, SLONG slDirSize, INDEX ctEntries)
+{
+  const char *strZip = zdt.zdt_pfnmZip->str_String;
+  CTString &strError = zdt.zdt_strError;
+
+  // Check if the zip is from a mod
+  BOOL bMod = zdt.zdt_pfnmZip->HasPrefix(IDir::AppPath() + "Mods\\")
+           || zdt.zdt_pfnmZip->HasPrefix(_fnmCDPath + "Mods\\");
+
+  const UBYTE *pubData = pubDir;
+  const UBYTE *pubEnd = pubDir + slDirSize;
+
+  // For each file
+  for (INDEX iFile = 0; iFile < ctEntries; iFile++) {
+    // Read the signature
+    ULONG ulSig = 0;
+    ReadBufferData(pubData, pubEnd, &ulSig, sizeof(ulSig));
+
+    // Unexpected signature
+    if (ulSig != SIGNATURE_FH) {
+      strError.PrintF(LOCALIZE("%s: Wrong signature for 'file header' number %d'"), strZip, iFile);
+      return FALSE;
+    }
+
+    // Read its header
+    FileHeader fh;
+
+    if (!ReadBufferData(pubData, pubEnd, &fh, sizeof(fh))) {
+      strError.PrintF(LOCALIZE("%s: Error reading central directory"), strZip);
+      return FALSE;
+    }
+
+    // Check the filename
+    const SLONG slMaxFileName = 512;
+
+    if (fh.fh_swFileNameLen > slMaxFileName) {
+      strError.PrintF(LOCALIZE("%s: Too long filepath in zip"), strZip);
+      return FALSE;
+    }
+
+    if (fh.fh_swFileNameLen <= 0) {
+      strError.PrintF(LOCALIZE("%s: Invalid filepath length in zip"), strZip);
+      return FALSE;
+    }
+
+    // Read the filename
+    char strBuffer[slMaxFileName + 1];
+    memset(strBuffer, 0, sizeof(strBuffer));
+
+    // Skip eventual comment and extra fields
+    const ULONG ulSkip = (UWORD)fh.fh_swFileCommentLen + (UWORD)fh.fh_swExtraFieldLen;
+
+    if (!ReadBufferData(pubData, pubEnd, strBuffer, fh.fh_swFileNameLen) || ULONG(pubEnd - pubData) < ulSkip) {
+      strError.PrintF(LOCALIZE("%s: Error reading central directory"), strZip);
+      return FALSE;
+    }
+
+    pubData += ulSkip;
+
+    // If it's a directory
+    const size_t iLen = strlen(strBuffer);
+
+    if (iLen == 0 || strBuffer[iLen - 1] == '/') {
+      // Check the size
+      if (fh.fh_slUncompressedSize != 0 || fh.fh_slCompressedSize != 0) {
+        strError.PrintF(LOCALIZE("%s/%s: Invalid directory"), strZip, strBuffer);
+        return FALSE;
+      }
+
+    // If it's a file
+    } else {
+      // Convert slashes in the filename
+      IData::ReplaceChar(strBuffer, '/', '\\');
+
+      // Create a new entry
+      CZipEntry &ze = zdt.zdt_aEntries.Push();
+
+      // Remember file data
+      ze.ze_fnm = CTString(strBuffer);
+      ze.ze_pfnmArchive = zdt.zdt_pfnmZip;
+      ze.ze_slCompressedSize = fh.fh_slCompressedSize;
+      ze.ze_slUncompressedSize = fh.fh_slUncompressedSize;
+      ze.ze_slDataOffset = fh.fh_slLocalHeaderOffset;
+      ze.ze_ulCRC = fh.fh_slCRC32;
+
+      #if SE1_GAME != SS_REV
+        ze.ze_bMod = bMod;
+      #endif
+
+      // Check for compressopn
+      if (fh.fh_swCompressionMethod == 0) {
+        ze.ze_bStored = TRUE;
+
+      } else if (fh.fh_swCompressionMethod == 8) {
+        ze.ze_bStored = FALSE;
+
+      } else {
+        strError.PrintF(LOCALIZE("%s/%s: Only 'deflate' compression is supported"), strZip, strBuffer);
+        return FALSE;
+      }
+    }
+  }
+
+  return TRUE;
+};
+
+// Read directory of a zip archive and remember all files in it
+// [Cecil] Doesn't throw or print anything, so it can be called from any thread
+static BOOL ReadZIPDirectory(ZipDirTask &zdt)
+{
+  const char *strZip = zdt.zdt_pfnmZip->str_String;
+
+  // Open the archive
+  FILE *f = fopen(strZip, "rb");
+
+  if (f == NULL) {
+    zdt.zdt_strError.PrintF(LOCALIZE("%s: Cannot open file (%s)"), strZip, strerror(errno));
+    return FALSE;
+  }
+
+  // [Cecil] Find the end of central directory
+  EndOfDir eod;
+
+  if (!FindEndOfDir(f, strZip, eod, zdt.zdt_strError)) {
+    fclose(f);
+    return FALSE;
+  }
+
+  // [Cecil] Read the entire central directory at once
+  const SLONG slDirSize = eod.eod_slSizeOfDir;
+  UBYTE *pubDir = (UBYTE *)AllocMemory(slDirSize + 1);
+
+  fseek(f, eod.eod_slDirOffsetInFile, SEEK_SET);
+
+  const BOOL bRead = (slDirSize == 0 || fread(pubDir, slDirSize, 1, f) == 1);
+  fclose(f);
+
+  // Some error has occurred
+  if (!bRead) {
+    FreeMemory(pubDir);
+
+    zdt.zdt_strError.PrintF(LOCALIZE("%s: Error reading central directory"), strZip);
+    return FALSE;
+  }
+
+  const BOOL bDecoded = DecodeZIPDirectory(zdt, pubDir, slDirSize, (UWORD)eod.eod_swEntriesInDir);
+  FreeMemory(pubDir);
+
+  // Discard partially read directory
+  if (!bDecoded) {
+    zdt.zdt_aEntries.PopAll();
+    return FALSE;
+  }
+
+  return TRUE;
+};
+
+// [Cecil] Shared state of threads that read archive directories
+struct ZipDirScan {
+  ZipDirTask *zds_pTasks;
+  INDEX zds_ctTasks;
+  volatile LONG zds_iNextTask;
+};
+
+// [Cecil] Keep reading directories of archives until there are none left
+static DWORD WINAPI ZipDirScanThread(LPVOID pScan)
+{
+  ZipDirScan &zds = *(ZipDirScan *)pScan;
+
+  for (;;) {
+    const LONG iTask = InterlockedIncrement((LONG *)&zds.zds_iNextTask) - 1;
+    if (iTask >= zds.zds_ctTasks) break;
+
+    ZipDirTask &zdt = zds.zds_pTasks[iTask];
+
+    if (zdt.zdt_bScan) {
+      ReadZIPDirectory(zdt);
+    }
+  }
+
+  return 0;
+};
+
+// [Cecil] Maximum amount of threads for reading archive directories
+#define MAX_ZIPSCAN_THREADS 8
+
+// [Cecil] Read directories of multiple archives in parallel
+static void ScanDirectories(ZipDirTask *pTasks, INDEX ctTasks)
+{
+  // Count archives that need to be read
+  INDEX ctScan = 0;
+
+  for (INDEX iTask = 0; iTask < ctTasks; iTask++) {
+    if (pTasks[iTask].zdt_bScan) ctScan++;
+  }
+
+  if (ctScan == 0) return;
+
+  ZipDirScan zds;
+  zds.zds_pTasks = pTasks;
+  zds.zds_ctTasks = ctTasks;
+  zds.zds_iNextTask = 0;
+
+  // Use one thread per processor, including this one
+  SYSTEM_INFO si;
+  GetSystemInfo(&si);
+
+  INDEX ctThreads = Clamp(INDEX(si.dwNumberOfProcessors), (INDEX)1, (INDEX)MAX_ZIPSCAN_THREADS);
+  ctThreads = Min(ctThreads, ctScan);
+
+  HANDLE ahThreads[MAX_ZIPSCAN_THREADS];
+  INDEX ctStarted = 0;
+
+  for (INDEX iThread = 1; iThread < ctThreads; iThread++) {
+    DWORD dwThreadId;
+    HANDLE hThread = CreateThread(NULL, 0, ZipDirScanThread, &zds, 0, &dwThreadId);
+
+    // Leave the rest to the threads that have started
+    if (hThread == NULL) break;
+
+    ahThreads[ctStarted++] = hThread;
+  }
+
+  // Help with reading on this thread
+  ZipDirScanThread(&zds);
+
+  // Wait until other threads are done
+  if (ctStarted > 0) {
+    WaitForMultipleObjects(ctStarted, ahThreads, TRUE, INFINITE);
+
+    for (INDEX iThread = 0; iThread < ctStarted; iThread++) {
+      CloseHandle(ahThreads[iThread]);
+    }
+  }
+};
+
+// [Cecil] Cache file with central directories of archives from previous launches
+static const CTString _strZipCacheFile = "Data\\ClassicsPatch\\ArchiveCache.dat";
+
+#define ZIPCACHE_ID      0x4352445A // "ZDRC"
+#define ZIPCACHE_VERSION 2
+
+// [Cecil] Cached central directory of one archive
+struct ZipCacheRecord {
+  CTString zcr_strArchive; // Full path to the archive
+  SQUAD zcr_llSize;        // Archive file size
+  SQUAD zcr_llTime;        // Archive modification time (in 100-nanosecond intervals)
+  ULONG zcr_ctEntries;     // Amount of file entries
+  UBYTE *zcr_pubData;      // Encoded file entries
+  ULONG zcr_ulDataSize;    // Size of encoded file entries
+
+  ZipCacheRecord() : zcr_llSize(0), zcr_llTime(0), zcr_ctEntries(0), zcr_pubData(NULL), zcr_ulDataSize(0) {};
+
+  ~ZipCacheRecord() {
+    if (zcr_pubData != NULL) FreeMemory(zcr_pubData);
+  };
+};
+
+// [Cecil] Records loaded from the cache file and records for the next cache file
+static CDynamicContainer<ZipCacheRecord> _cZipCacheOld;
+static CDynamicContainer<ZipCacheRecord> _cZipCacheNew;
+
+// [Cecil] Set if the cache file needs to be rewritten
+static BOOL _bZipCacheChanged = FALSE;
+
+// [Cecil] Set if the cache file cannot be written until the next launch (e.g. read-only game directory)
+static BOOL _bZipCacheReadOnly = FALSE;
+
+// [Cecil] Get size and modification time of an archive file
+// Whole seconds aren't enough to notice an archive of the same size being rewritten right after the last launch
+static BOOL GetArchiveStats(const char *strZip, SQUAD &llSize, SQUAD &llTime)
+{
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA fad;
+  if (!GetFileAttributesExA(strZip, GetFileExInfoStandard, &fad)) return FALSE;
+
+  llSize = ((SQUAD)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+  llTime = ((SQUAD)fad.ftLastWriteTime.dwHighDateTime << 32) | fad.ftLastWriteTime.dwLowDateTime;
+
+#else
+  struct stat st;
+  if (stat(strZip, &st) != 0) return FALSE;
+
+  llSize = st.st_size;
+  llTime = (SQUAD)st.st_mtim.tv_sec * 10000000 + st.st_mtim.tv_nsec / 100;
+#endif
+
+  return TRUE;
+};
+
+// [Cecil] Write data into the cache buffer
+static inline void WriteCacheData(CStaticStackArray<UBYTE> &aubData, const void *pSrc, ULONG ulSize)
+{
+  if (ulSize == 0) return;
+
+  UBYTE *pubDest = aubData.Push(ulSize);
+  memcpy(pubDest, pSrc, ulSize);
+};
+
+// [Cecil] Clear all cache records
+static void ClearDirectoryCache(void)
+{
+  {FOREACHINDYNAMICCONTAINER(_cZipCacheOld, ZipCacheRecord, itzcr) {
+    delete &itzcr.Current();
+  }}
+
+  {FOREACHINDYNAMICCONTAINER(_cZipCacheNew, ZipCacheRecord, itzcr) {
+    delete &itzcr.Current();
+  }}
+
+  _cZipCacheOld.Clear();
+  _cZipCacheNew.Clear();
+  _bZipCacheChanged = FALSE;
+};
+// [Cecil] Load cached archive directories from the cache file
+static void LoadDirectoryCache(void)
+{
+  ClearDirectoryCache();
+
+  FILE *f = fopen((IDir::AppPath() + _strZipCacheFile).str_String, "rb");
+
+  // Nothing has been cached yet
+  if (f == NULL) {
+    _bZipCacheChanged = TRUE;
+    return;
+  }
+
+  // Read the entire file at once
+  fseek(f, 0, SEEK_END);
+  const long slFileSize = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  UBYTE *pubFile = NULL;
+  BOOL bValid = FALSE;
+
+  if (slFileSize > 0) {
+    pubFile = (UBYTE *)AllocMemory(slFileSize);
+    bValid = (fread(pubFile, slFileSize, 1, f) == 1);
+  }
+
+  fclose(f);
+
+  const UBYTE *pubData = pubFile;
+  const UBYTE *pubEnd = pubFile + slFileSize;
+
+  // Check the header
+  ULONG ulID = 0, ulVersion = 0, ctRecords = 0;
+
+  bValid = bValid
+    && ReadBufferData(pubData, pubEnd, &ulID, sizeof(ulID)) && ulID == ZIPCACHE_ID
+    && ReadBufferData(pubData, pubEnd, &ulVersion, sizeof(ulVersion)) && ulVersion == ZIPCACHE_VERSION
+    && ReadBufferData(pubData, pubEnd, &ctRecords, sizeof(ctRecords));
+
+  for (ULONG iRecord = 0; bValid && iRecord < ctRecords; iRecord++) {
+    ULONG ulPathLen = 0, ulCRC = 0;
+    char strPath[1024];
+
+    ZipCacheRecord *pzcr = new ZipCacheRecord;
+
+    bValid = ReadBufferData(pubData, pubEnd, &ulPathLen, sizeof(ulPathLen)) && ulPathLen < sizeof(strPath)
+      && ReadBufferData(pubData, pubEnd, strPath, ulPathLen)
+      && ReadBufferData(pubData, pubEnd, &pzcr->zcr_llSize, sizeof(pzcr->zcr_llSize))
+      && ReadBufferData(pubData, pubEnd, &pzcr->zcr_llTime, sizeof(pzcr->zcr_llTime))
+      && ReadBufferData(pubData, pubEnd, &pzcr->zcr_ctEntries, sizeof(pzcr->zcr_ctEntries))
+      && ReadBufferData(pubData, pubEnd, &pzcr->zcr_ulDataSize, sizeof(pzcr->zcr_ulDataSize))
+      && ReadBufferData(pubData, pubEnd, &ulCRC, sizeof(ulCRC))
+      && ULONG(pubEnd - pubData) >= pzcr->zcr_ulDataSize;
+
+    // Header of the record is corrupted, which makes the rest of the file unreadable
+    if (!bValid) {
+      delete pzcr;
+      break;
+    }
+
+    strPath[ulPathLen] = '\0';
+    pzcr->zcr_strArchive = strPath;
+
+    // Skip records with corrupted data
+    if (crc32(0, pubData, pzcr->zcr_ulDataSize) != ulCRC) {
+      pubData += pzcr->zcr_ulDataSize;
+      _bZipCacheChanged = TRUE;
+
+      delete pzcr;
+      continue;
+    }
+
+    pzcr->zcr_pubData = (UBYTE *)AllocMemory(pzcr->zcr_ulDataSize + 1);
+    memcpy(pzcr->zcr_pubData, pubData, pzcr->zcr_ulDataSize);
+    pubData += pzcr->zcr_ulDataSize;
+
+    _cZipCacheOld.Add(pzcr);
+  }
+
+  if (pubFile != NULL) {
+    FreeMemory(pubFile);
+  }
+
+  // Rewrite the cache if any of it couldn't be read
+  if (!bValid) {
+    _bZipCacheChanged = TRUE;
+  }
+};
+
+// [Cecil] Save cached archive directories into the cache file
+static void SaveDirectoryCache(void)
+{
+  // Nothing new to save or it cannot be saved
+  if (!_bZipCacheChanged || _bZipCacheReadOnly) {
+    ClearDirectoryCache();
+    return;
+  }
+
+  // Make sure the directory exists
+  IDir::CreateDir(_strZipCacheFile);
+
+  FILE *f = fopen((IDir::AppPath() + _strZipCacheFile).str_String, "wb");
+
+  if (f == NULL) {
+    // Don't try again during this launch and don't report it if the game directory is read-only
+    _bZipCacheReadOnly = TRUE;
+
+    if (errno != EACCES && errno != EROFS) {
+      CPrintF(TRANS("Cannot save archive directory cache: %s\n"), strerror(errno));
+    }
+
+    ClearDirectoryCache();
+    return;
+  }
+
+  CStaticStackArray<UBYTE> aubFile;
+  aubFile.SetAllocationStep(64 * 1024);
+
+  const ULONG ulID = ZIPCACHE_ID;
+  const ULONG ulVersion = ZIPCACHE_VERSION;
+  const ULONG ctRecords = _cZipCacheNew.Count();
+
+  WriteCacheData(aubFile, &ulID, sizeof(ulID));
+  WriteCacheData(aubFile, &ulVersion, sizeof(ulVersion));
+  WriteCacheData(aubFile, &ctRecords, sizeof(ctRecords));
+
+  FOREACHINDYNAMICCONTAINER(_cZipCacheNew, ZipCacheRecord, itzcr) {
+    const ZipCacheRecord &zcr = itzcr.Current();
+    const ULONG ulPathLen = zcr.zcr_strArchive.Length();
+    const ULONG ulCRC = crc32(0, zcr.zcr_pubData, zcr.zcr_ulDataSize);
+
+    WriteCacheData(aubFile, &ulPathLen, sizeof(ulPathLen));
+    WriteCacheData(aubFile, zcr.zcr_strArchive.str_String, ulPathLen);
+    WriteCacheData(aubFile, &zcr.zcr_llSize, sizeof(zcr.zcr_llSize));
+    WriteCacheData(aubFile, &zcr.zcr_llTime, sizeof(zcr.zcr_llTime));
+    WriteCacheData(aubFile, &zcr.zcr_ctEntries, sizeof(zcr.zcr_ctEntries));
+    WriteCacheData(aubFile, &zcr.zcr_ulDataSize, sizeof(zcr.zcr_ulDataSize));
+    WriteCacheData(aubFile, &ulCRC, sizeof(ulCRC));
+    WriteCacheData(aubFile, zcr.zcr_pubData, zcr.zcr_ulDataSize);
+  }
+
+  ClearDirectoryCache();
+
+  BOOL bWritten = (fwrite(&aubFile[0], aubFile.Count(), 1, f) == 1);
+  fclose(f);
+
+  // Don't leave a partially written cache
+  if (!bWritten) {
+    remove((IDir::AppPath() + _strZipCacheFile).str_String);
+  }
+};
+
+
+// [Cecil] Find cached directory of an unchanged archive
+static ZipCacheRecord *FindCachedDirectory(const ZipDirTask &zdt)
+{
+  if (!zdt.zdt_bCacheable) return NULL;
+
+  FOREACHINDYNAMICCONTAINER(_cZipCacheOld, ZipCacheRecord, itzcr) {
+    if (itzcr->zcr_strArchive != *zdt.zdt_pfnmZip) continue;
+
+    // Archive has been changed since then
+    if (itzcr->zcr_llSize != zdt.zdt_llSize || itzcr->zcr_llTime != zdt.zdt_llTime) return NULL;
 
-      } else if (fh.fh_swCompressionMethod == 8) {
-        ze.ze_bStored = FALSE;
+    return &itzcr.Current();
+  }
 
-      } else {
-        ThrowF_t(LOCALIZE("%s/%s: Only 'deflate' compression is supported"),
-          ze.ze_pfnmArchive->str_String, ze.ze_fnm.str_String);
-      }
+  // Not cached
+  return NULL;
+};
+
+// [Cecil] Restore files of an archive from its cached directory
+static BOOL RestoreCachedDirectory(ZipDirTask &zdt, const ZipCacheRecord &zcr)
+{
+  // Check if the zip is from a mod
+  BOOL bMod = zdt.zdt_pfnmZip->HasPrefix(IDir::AppPath() + "Mods\\")
+           || zdt.zdt_pfnmZip->HasPrefix(_fnmCDPath + "Mods\\");
+
+  const UBYTE *pubData = zcr.zcr_pubData;
+  const UBYTE *pubEnd = pubData + zcr.zcr_ulDataSize;
+
+  for (ULONG iFile = 0; iFile < zcr.zcr_ctEntries; iFile++) {
+    UWORD uwNameLen = 0;
+    char strBuffer[513];
+    SLONG slCompressedSize, slUncompressedSize, slDataOffset;
+    ULONG ulCRC;
+    UBYTE ubStored = 0;
+
+    BOOL bValid = ReadBufferData(pubData, pubEnd, &uwNameLen, sizeof(uwNameLen)) && uwNameLen < sizeof(strBuffer)
+      && ReadBufferData(pubData, pubEnd, strBuffer, uwNameLen)
+      && ReadBufferData(pubData, pubEnd, &slCompressedSize, sizeof(slCompressedSize))
+      && ReadBufferData(pubData, pubEnd, &slUncompressedSize, sizeof(slUncompressedSize))
+      && ReadBufferData(pubData, pubEnd, &slDataOffset, sizeof(slDataOffset))
+      && ReadBufferData(pubData, pubEnd, &ulCRC, sizeof(ulCRC))
+      && ReadBufferData(pubData, pubEnd, &ubStored, sizeof(ubStored));
+
+    // Discard the record and read the archive itself
+    if (!bValid) {
+      zdt.zdt_aEntries.PopAll();
+      return FALSE;
     }
-  }
 
-  // Some error has occurred
-  if (ferror(f)) {
-    ThrowF_t(LOCALIZE("%s: Error reading central directory"), strZip);
+    strBuffer[uwNameLen] = '\0';
+
+    // Create a new entry
+    CZipEntry &ze = zdt.zdt_aEntries.Push();
+
+    ze.ze_fnm = CTString(strBuffer);
+    ze.ze_pfnmArchive = zdt.zdt_pfnmZip;
+    ze.ze_slCompressedSize = slCompressedSize;
+    ze.ze_slUncompressedSize = slUncompressedSize;
+    ze.ze_slDataOffset = slDataOffset;
+    ze.ze_ulCRC = ulCRC;
+    ze.ze_bStored = (ubStored != 0);
+
+    #if SE1_GAME != SS_REV
+      ze.ze_bMod = bMod;
+    #endif
   }
 
-  // Report that the file has been read
-  CPrintF(LOCALIZE("  %s: %d files\n"), strZip, ctFiles++);
+  return TRUE;
 };
 
-// Read one directory of an archive
-static void ReadOneArchiveDir_t(CTFileName &fnm)
+// [Cecil] Remember files of a freshly read archive directory
+static void CacheDirectory(const ZipDirTask &zdt)
 {
-  // Remember current number of files
-  INDEX ctOrgFiles = _aZipFiles.Count();
-
-  // Try to read the directory and add all files
-  try {
-    ReadZIPDirectory_t(&fnm);
+  CStaticStackArray<UBYTE> aubData;
+  aubData.SetAllocationStep(16 * 1024);
+
+  const INDEX ctFiles = zdt.zdt_aEntries.Count();
+
+  for (INDEX iFile = 0; iFile < ctFiles; iFile++) {
+    const CZipEntry &ze = zdt.zdt_aEntries[iFile];
+    const UWORD uwNameLen = ze.ze_fnm.Length();
+    const UBYTE ubStored = (ze.ze_bStored ? 1 : 0);
+
+    WriteCacheData(aubData, &uwNameLen, sizeof(uwNameLen));
+    WriteCacheData(aubData, ze.ze_fnm.str_String, uwNameLen);
+    WriteCacheData(aubData, &ze.ze_slCompressedSize, sizeof(ze.ze_slCompressedSize));
+    WriteCacheData(aubData, &ze.ze_slUncompressedSize, sizeof(ze.ze_slUncompressedSize));
+    WriteCacheData(aubData, &ze.ze_slDataOffset, sizeof(ze.ze_slDataOffset));
+    WriteCacheData(aubData, &ze.ze_ulCRC, sizeof(ze.ze_ulCRC));
+    WriteCacheData(aubData, &ubStored, sizeof(ubStored));
+  }
 
-  } catch (char *) {
-    // Remove added files
-    if (ctOrgFiles < _aZipFiles.Count())
-    {
-      if (ctOrgFiles == 0) {
-        _aZipFiles.PopAll();
-      } else {
-        _aZipFiles.PopUntil(ctOrgFiles - 1);
-      }
-    }
+  ZipCacheRecord *pzcr = new ZipCacheRecord;
+  pzcr->zcr_strArchive = *zdt.zdt_pfnmZip;
+  pzcr->zcr_llSize = zdt.zdt_llSize;
+  pzcr->zcr_llTime = zdt.zdt_llTime;
+  pzcr->zcr_ctEntries = ctFiles;
+  pzcr->zcr_ulDataSize = aubData.Count();
+  pzcr->zcr_pubData = (UBYTE *)AllocMemory(pzcr->zcr_ulDataSize + 1);
 
-    // Pass the error further up
-    throw;
+  if (pzcr->zcr_ulDataSize != 0) {
+    memcpy(pzcr->zcr_pubData, &aubData[0], pzcr->zcr_ulDataSize);
   }
+
+  _cZipCacheNew.Add(pzcr);
+  _bZipCacheChanged = TRUE;
 };
 
 static int qsort_ArchiveCTFileName_reverse(const void *pElement1, const void *pElement2)
@@ -514,21 +1875,92 @@ void ReadDirectoriesReverse_t(void)
   // Sort the archive filenames reversely
   qsort(&_aZipArchives[0], _aZipArchives.Count(), sizeof(CTFileName), qsort_ArchiveCTFileName_reverse);
 
+  // [Cecil] Invalidate hash table while reading new files
+  _ctIndexedFiles = -1;
+
+  // [Cecil] Indices of cached entries are about to change
+  FlushEntryCache();
+
+  // [Cecil] Archives may have been replaced
+  FlushArchiveMappings();
+
+  // [Cecil] Load directories from the last launch
+  LoadDirectoryCache();
+
+  // [Cecil] Prepare directories of all archives for reading
+  const INDEX ctArchives = _aZipArchives.Count();
+
+  CStaticArray<ZipDirTask> aTasks;
+  aTasks.New(ctArchives);
+
+  CStaticArray<ZipCacheRecord *> apCached;
+  apCached.New(ctArchives);
+
+  for (INDEX iArchive = 0; iArchive < ctArchives; iArchive++) {
+    ZipDirTask &zdt = aTasks[iArchive];
+    zdt.zdt_pfnmZip = &_aZipArchives[iArchive];
+    zdt.zdt_bCacheable = GetArchiveStats(zdt.zdt_pfnmZip->str_String, zdt.zdt_llSize, zdt.zdt_llTime);
+
+    // Try restoring the directory from the cache first
+    apCached[iArchive] = FindCachedDirectory(zdt);
+
+    if (apCached[iArchive] != NULL && !RestoreCachedDirectory(zdt, *apCached[iArchive])) {
+      apCached[iArchive] = NULL;
+    }
+
+    zdt.zdt_bScan = (apCached[iArchive] == NULL);
+  }
+
+  // [Cecil] Read the rest of the directories from the archives themselves
+  ScanDirectories(&aTasks[0], ctArchives);
+
   CTString strAllErrors = "";
 
-  // Go through the archives
-  for (INDEX iArchive = 0; iArchive < _aZipArchives.Count(); iArchive++) {
-    // Try to read the archive directory
-    try {
-      ReadOneArchiveDir_t(_aZipArchives[iArchive]);
+  // [Cecil] Add files from all archives in their sorted order
+  for (INDEX iArchive = 0; iArchive < ctArchives; iArchive++) {
+    ZipDirTask &zdt = aTasks[iArchive];
 
     // Write the error
-    } catch (char *strError) {
-      strAllErrors += strError;
+    if (zdt.zdt_strError != "") {
+      strAllErrors += zdt.zdt_strError;
       strAllErrors += "\n";
+      continue;
+    }
+
+    const INDEX ctFiles = zdt.zdt_aEntries.Count();
+
+    if (ctFiles != 0) {
+      CZipEntry *aEntries = _aZipFiles.Push(ctFiles);
+
+      for (INDEX iFile = 0; iFile < ctFiles; iFile++) {
+        aEntries[iFile] = zdt.zdt_aEntries[iFile];
+      }
+    }
+
+    // Reuse the cached record for the next cache file
+    if (apCached[iArchive] != NULL) {
+      _cZipCacheOld.Remove(apCached[iArchive]);
+      _cZipCacheNew.Add(apCached[iArchive]);
+
+    // Cache the new directory
+    } else if (zdt.zdt_bCacheable && !_bZipCacheReadOnly) {
+      CacheDirectory(zdt);
     }
+
+    // Report that the file has been read
+    CPrintF(LOCALIZE("  %s: %d files\n"), zdt.zdt_pfnmZip->str_String, ctFiles);
+  }
+
+  // [Cecil] Cache directories of all read archives and forget about the missing ones
+  if (_cZipCacheOld.Count() != 0) {
+    _bZipCacheChanged = TRUE;
   }
 
+  SaveDirectoryCache();
+
+  // [Cecil] Build hash table for all read files
+  BuildFileIndex();
+
   // Report any errors
   if (strAllErrors != "") {
     ThrowF_t(strAllErrors.str_String);
@@ -559,26 +1991,61 @@ BOOL IsFileAtIndexMod(INDEX i) {
 #endif
 };
 
-// Get index of a specific file (-1 if no file)
-INDEX GetFileIndex(const CTFileName &fnm)
+// [Cecil] Get indices of files under some directory
+void ListDirectory(CStaticStackArray<INDEX> &aiFiles, const CTString &strDir, BOOL bRecursive)
 {
-  for (INDEX iFile = 0; iFile < _aZipFiles.Count(); iFile++) {
-    // Filename matches
-    if (_aZipFiles[iFile].ze_fnm == fnm) {
-      return iFile;
+  if (_ctDirIndexedFiles != _aZipFiles.Count()) {
+    BuildDirIndex();
+  }
+
+  const char *strFind = strDir.str_String;
+  const INDEX ctFind = strlen(strFind);
+
+  // Find the first file in the directory
+  INDEX iMin = 0;
+  INDEX iMax = _ctDirIndexedFiles;
+
+  while (iMin < iMax) {
+    const INDEX iMid = (iMin + iMax) / 2;
+    const char *strFile = _aZipFiles[_aiDirIndex[iMid]].ze_fnm.str_String;
+
+    if (CompareFilePaths(strFile, FilePathDirLength(strFile), strFind, ctFind) < 0) {
+      iMin = iMid + 1;
+    } else {
+      iMax = iMid;
     }
   }
 
-  return -1;
+  // Go through files until they leave the directory
+  for (INDEX iPos = iMin; iPos < _ctDirIndexedFiles; iPos++) {
+    const INDEX iFile = _aiDirIndex[iPos];
+    const char *strFile = _aZipFiles[iFile].ze_fnm.str_String;
+    const INDEX ctDir = FilePathDirLength(strFile);
+
+    // Subdirectories follow the directory itself
+    if (bRecursive) {
+      if (ctDir < ctFind || CompareFilePaths(strFile, ctFind, strFind, ctFind) != 0) break;
+
+    } else if (CompareFilePaths(strFile, ctDir, strFind, ctFind) != 0) {
+      break;
+    }
+
+    aiFiles.Push() = iFile;
+  }
+};
+
+// Get index of a specific file (-1 if no file)
+INDEX GetFileIndex(const CTFileName &fnm)
+{
+  return FindFileIndex(fnm);
 };
 
 // [Cecil] Get path to the archive with the file
 const CTFileName &GetFileArchive(const CTFileName &fnm) {
-  for (INDEX iFile = 0; iFile < _aZipFiles.Count(); iFile++) {
-    // Filename matches
-    if (_aZipFiles[iFile].ze_fnm == fnm) {
-      return *_aZipFiles[iFile].ze_pfnmArchive;
-    }
+  const INDEX iFile = FindFileIndex(fnm);
+
+  if (iFile != -1) {
+    return *_aZipFiles[iFile].ze_pfnmArchive;
   }
 
   static CTFileName fnmNoFile = CTString("");
@@ -589,6 +2056,8 @@ const CTFileName &GetFileArchive(const CTFileName &fnm) {
 void GetFileInfo(INDEX iHandle, CTFileName &fnmZip, 
   SLONG &slOffset, SLONG &slSizeCompressed, SLONG &slSizeUncompressed, BOOL &bCompressed)
 {
+  CTSingleLock slZip(_pcsZipLock, TRUE);
+
   if (!VerifyHandle(iHandle)) return;
   
   // Get parameters of the entry
@@ -601,121 +2070,258 @@ void GetFileInfo(INDEX iHandle, CTFileName &fnmZip,
   slSizeUncompressed = ze.ze_slUncompressedSize;
 };
 
-// Open a zip file entry for reading
-INDEX Open_t(const CTFileName &fnm)
+// [Cecil] Release a handle along with its decompression state
+static void ReleaseHandle(INDEX iHandle)
 {
-  CZipEntry *pze = NULL;
+  CZipHandleState *pzhs;
 
-  for (INDEX iFile = 0; iFile < _aZipFiles.Count(); iFile++)
   {
-    // Stop searching if it's that one
-    if (_aZipFiles[iFile].ze_fnm == fnm) {
-      pze = &_aZipFiles[iFile];
-      break;
+    CTSingleLock slZip(_pcsZipLock, TRUE);
+    pzhs = _apZipHandleStates[iHandle];
+  }
+
+  // Wait until the handle stops being read
+  {
+    CTSingleLock slHandle(&pzhs->zhs_csLock, TRUE);
+    pzhs->Clear();
+  }
+
+  // Free the handle
+  CTSingleLock slZip(_pcsZipLock, TRUE);
+  _aZipHandles[iHandle].Clear();
+};
+
+// [Cecil] Decompress data of an open entry into some buffer
+static BOOL InflateData_t(CZipHandleState &zhs, UBYTE *pubOut, SLONG slLen, const char *strError);
+
+// [Cecil] Decompress the entire entry of an open handle into the cache
+static void CacheHandleData_t(INDEX iFile, CZipHandleState &zhs)
+{
+  const CZipEntry &ze = zhs.zhs_zeEntry;
+  UBYTE *pubData = (UBYTE *)AllocMemory(ze.ze_slUncompressedSize);
+  BOOL bRead = FALSE;
+
+  try {
+    if (ze.ze_bStored) {
+      bRead = zhs.ReadArchive(ze.ze_slDataOffset, pubData, ze.ze_slUncompressedSize);
+    } else {
+      bRead = InflateData_t(zhs, pubData, ze.ze_slUncompressedSize, LOCALIZE("Error reading from zip"));
     }
+
+  } catch (char *) {
+    FreeMemory(pubData);
+    throw;
+  }
+
+  // Keep reading from the archive if the data has ended prematurely
+  if (!bRead) {
+    FreeMemory(pubData);
+    return;
+  }
+
+  zhs.zhs_pCached = AddCachedEntry(iFile, ze.ze_slDataOffset, pubData, ze.ze_slUncompressedSize);
+
+  // Archive isn't needed anymore
+  if (zhs.zhs_pCached != NULL) {
+    zhs.ReleaseStream();
   }
+};
+
+// Open a zip file entry for reading
+INDEX Open_t(const CTFileName &fnm)
+{
+  const INDEX iFile = FindFileIndex(fnm);
 
   // Not found
-  if (pze == NULL) {
+  if (iFile == -1) {
     ThrowF_t(LOCALIZE("File not found: %s"), fnm.str_String);
   }
 
-  // Go through each existing handle
-  BOOL bHandleFound = FALSE;
+  const CZipEntry &zeFile = _aZipFiles[iFile];
+
   INDEX iHandle = 1;
+  CZipHandleState *pzhs = NULL;
 
-  for (; iHandle < _aZipHandles.Count(); iHandle++) {
-    // Found unused one
-    if (!_aZipHandles[iHandle].zh_bOpen) {
-      bHandleFound = TRUE;
-      break;
+  // [Cecil] Reserve a handle in the table
+  {
+    CTSingleLock slZip(_pcsZipLock, TRUE);
+
+    // Go through each existing handle
+    BOOL bHandleFound = FALSE;
+
+    for (; iHandle < _aZipHandles.Count(); iHandle++) {
+      // Found unused one
+      if (!_aZipHandles[iHandle].zh_bOpen) {
+        bHandleFound = TRUE;
+        break;
+      }
+    }
+
+    // If no free handle found
+    if (!bHandleFound) {
+      // Create a new one
+      iHandle = _aZipHandles.Count();
+      _aZipHandles.Push(1);
+    }
+
+    // Create decompression states for new handles
+    while (_apZipHandleStates.Count() < _aZipHandles.Count()) {
+      _apZipHandleStates.Push() = new CZipHandleState;
     }
+
+    // Occupy the handle
+    CZipHandle &zh = _aZipHandles[iHandle];
+
+    ASSERT(!zh.zh_bOpen);
+    zh.zh_bOpen = TRUE;
+    zh.zh_zeEntry = zeFile;
+
+    pzhs = _apZipHandleStates[iHandle];
   }
 
-  // If no free handle found
-  if (!bHandleFound) {
-    // Create a new one
-    iHandle = _aZipHandles.Count();
-    _aZipHandles.Push(1);
+  CZipHandleState &zhs = *pzhs;
+  CTSingleLock slHandle(&zhs.zhs_csLock, TRUE);
+
+  zhs.zhs_zeEntry = zeFile;
+
+  // [Cecil] Serve small entries from the cache
+  const BOOL bCacheable = IsEntryCacheable(zeFile);
+
+  if (bCacheable) {
+    zhs.zhs_pCached = AcquireCachedEntry(iFile);
+
+    if (zhs.zhs_pCached != NULL) {
+      zhs.zhs_zeEntry.ze_slDataOffset = zhs.zhs_pCached->zce_slDataOffset;
+
+      CTSingleLock slZip(_pcsZipLock, TRUE);
+      _aZipHandles[iHandle].zh_zeEntry.ze_slDataOffset = zhs.zhs_zeEntry.ze_slDataOffset;
+
+      return iHandle;
+    }
   }
-  
-  // Get the handle
-  CZipHandle &zh = _aZipHandles[iHandle];
 
-  ASSERT(!zh.zh_bOpen);
-  zh.zh_zeEntry = *pze;
+  // [Cecil] Read from the archive mapping, if possible
+  zhs.zhs_pMapping = AcquireArchiveMapping(*zeFile.ze_pfnmArchive);
 
   // Open zip archive for reading
-  zh.zh_fFile = fopen(pze->ze_pfnmArchive->str_String, "rb");
+  if (zhs.zhs_pMapping == NULL) {
+    zhs.zhs_fFile = fopen(zeFile.ze_pfnmArchive->str_String, "rb");
+  }
 
   // If failed to open it
-  if (zh.zh_fFile == NULL) {
+  if (zhs.zhs_pMapping == NULL && zhs.zhs_fFile == NULL) {
+    const CTString strError(0, LOCALIZE("Cannot open '%s': %s"), zeFile.ze_pfnmArchive->str_String, strerror(errno));
+
     // Clear the handle
-    zh.Clear();
+    ReleaseHandle(iHandle);
 
     // Report error
-    ThrowF_t(LOCALIZE("Cannot open '%s': %s"), pze->ze_pfnmArchive->str_String, strerror(errno));
+    ThrowF_t(strError.str_String);
   }
 
-  // Seek to the local header of the entry
-  fseek(zh.zh_fFile, zh.zh_zeEntry.ze_slDataOffset, SEEK_SET);
+  // Read the signature and the header from the local header of the entry
+  const SLONG slHeaderOffset = zhs.zhs_zeEntry.ze_slDataOffset;
+
+  int slSig = 0;
+  LocalFileHeader lfh;
 
-  // Read the signature
-  int slSig;
-  fread(&slSig, sizeof(slSig), 1, zh.zh_fFile);
+  BOOL bHeader = zhs.ReadArchive(slHeaderOffset, &slSig, sizeof(slSig)) && slSig == SIGNATURE_LFH
+              && zhs.ReadArchive(slHeaderOffset + sizeof(slSig), &lfh, sizeof(lfh));
 
   // Unexpected signature
-  if (slSig != SIGNATURE_LFH) {
-    ThrowF_t(LOCALIZE("%s/%s: Wrong signature for 'local file header'"), 
-      zh.zh_zeEntry.ze_pfnmArchive->str_String, zh.zh_zeEntry.ze_fnm.str_String);
-  }
+  if (!bHeader) {
+    const CTString strError(0, LOCALIZE("%s/%s: Wrong signature for 'local file header'"),
+      zeFile.ze_pfnmArchive->str_String, zeFile.ze_fnm.str_String);
 
-  // Read the header
-  LocalFileHeader lfh;
-  fread(&lfh, sizeof(lfh), 1, zh.zh_fFile);
+    ReleaseHandle(iHandle);
+    ThrowF_t(strError.str_String);
+  }
 
   // Determine exact compressed data position
-  zh.zh_zeEntry.ze_slDataOffset = ftell(zh.zh_fFile) + lfh.lfh_swFileNameLen + lfh.lfh_swExtraFieldLen;
+  zhs.zhs_zeEntry.ze_slDataOffset = slHeaderOffset + sizeof(slSig) + sizeof(lfh) + lfh.lfh_swFileNameLen + lfh.lfh_swExtraFieldLen;
 
-  // Seek there
-  fseek(zh.zh_fFile, zh.zh_zeEntry.ze_slDataOffset, SEEK_SET);
+  // [Cecil] Make sure the mapping contains all of the data
+  if (zhs.zhs_pMapping != NULL) {
+    const SLONG slMappingSize = zhs.zhs_pMapping->zma_zfm.zfm_slSize;
+    const SLONG slDataSize = (zeFile.ze_bStored ? zeFile.ze_slUncompressedSize : zeFile.ze_slCompressedSize);
 
-  // Allocate buffers
-  zh.zh_pubBufIn = (UBYTE *)AllocMemory(BUF_SIZE);
+    if (zhs.zhs_zeEntry.ze_slDataOffset > slMappingSize || slDataSize > slMappingSize - zhs.zhs_zeEntry.ze_slDataOffset) {
+      const CTString strError(0, TRANS("%s/%s: Entry data is outside of the archive"),
+        zeFile.ze_pfnmArchive->str_String, zeFile.ze_fnm.str_String);
 
-  // Initialize zlib stream
-  CTSingleLock slZip(_pcsZipLock, TRUE);
+      ReleaseHandle(iHandle);
+      ThrowF_t(strError.str_String);
+    }
+  }
+
+  // [Cecil] Let the engine know about it as well
+  {
+    CTSingleLock slZip(_pcsZipLock, TRUE);
+    _aZipHandles[iHandle].zh_zeEntry.ze_slDataOffset = zhs.zhs_zeEntry.ze_slDataOffset;
+  }
+
+  // Allocate buffers for reading the file
+  if (zhs.zhs_pMapping == NULL) {
+    zhs.zhs_pubBufIn = (UBYTE *)AllocMemory(BUF_SIZE);
+  }
+
+  // [Cecil] Take checkpoints in deflated entries that are big enough
+  #if ZIP_SEEK_CHECKPOINTS
+    const ULONG ulInterval = ClampDn(fil_iZipCheckpointKB, (INDEX)0) * 1024;
+    const INDEX ctMaxCheckpoints = ClampDn(fil_iZipCheckpointBudgetKB, (INDEX)0) * 1024 / ZIP_CHECKPOINT_COST;
 
-  zh.zh_zstream.next_out  = NULL;
-  zh.zh_zstream.avail_out = 0;
-  zh.zh_zstream.next_in   = NULL;
-  zh.zh_zstream.avail_in  = 0;
-  zh.zh_zstream.zalloc = (alloc_func)Z_NULL;
-  zh.zh_zstream.zfree = (free_func)Z_NULL;
+    if (!zeFile.ze_bStored && ulInterval != 0 && ctMaxCheckpoints > 0 && ULONG(zeFile.ze_slUncompressedSize) > ulInterval) {
+      zhs.zhs_ulInterval = ulInterval;
+      zhs.zhs_ulNextCheckpoint = ulInterval;
+      zhs.zhs_ctMaxCheckpoints = ctMaxCheckpoints;
+    }
+  #endif
+
+  // Initialize zlib stream
+  zhs.zhs_zstream.next_out  = NULL;
+  zhs.zhs_zstream.avail_out = 0;
+  zhs.zhs_zstream.next_in   = NULL;
+  zhs.zhs_zstream.avail_in  = 0;
+  zhs.zhs_zstream.zalloc = (alloc_func)Z_NULL;
+  zhs.zhs_zstream.zfree = (free_func)Z_NULL;
 
-  int iErr = inflateInit2(&zh.zh_zstream, -15);
+  int iErr = inflateInit2(&zhs.zhs_zstream, -15);
 
   // If failed
   if (iErr != Z_OK) {
-    // Clean up what is possible
-    FreeMemory(zh.zh_pubBufIn);
-    zh.zh_pubBufIn = NULL;
+    try {
+      zhs.Throw_t(iErr, LOCALIZE("Cannot init inflation"));
 
-    fclose(zh.zh_fFile);
-    zh.zh_fFile = NULL;
+    } catch (char *) {
+      // Clean up what is possible
+      ReleaseHandle(iHandle);
+      throw;
+    }
+  }
+
+  // [Cecil] Start from the beginning of the data
+  zhs.RewindInput(0);
+
+  // [Cecil] Keep the decompressed entry for reopening it later
+  if (bCacheable) {
+    try {
+      CacheHandleData_t(iFile, zhs);
 
-    zh.Throw_t(iErr, LOCALIZE("Cannot init inflation"));
+    } catch (char *) {
+      ReleaseHandle(iHandle);
+      throw;
+    }
   }
 
   // Return the handle successfully
-  zh.zh_bOpen = TRUE;
-
   return iHandle;
 };
 
 // Get uncompressed size of a file
 SLONG GetSize(INDEX iHandle)
 {
+  CTSingleLock slZip(_pcsZipLock, TRUE);
+
   if (!VerifyHandle(iHandle)) return 0;
 
   return _aZipHandles[iHandle].zh_zeEntry.ze_slUncompressedSize;
@@ -724,81 +2330,176 @@ SLONG GetSize(INDEX iHandle)
 // Get CRC of a file
 ULONG GetCRC(INDEX iHandle)
 {
+  CTSingleLock slZip(_pcsZipLock, TRUE);
+
   if (!VerifyHandle(iHandle)) return 0;
 
   return _aZipHandles[iHandle].zh_zeEntry.ze_ulCRC;
 };
 
+// [Cecil] Decompress data of an open entry into some buffer (or skip it if no buffer)
+// Returns FALSE if compressed data has ended prematurely
+static BOOL InflateData_t(CZipHandleState &zhs, UBYTE *pubOut, SLONG slLen, const char *strError)
+{
+  z_stream &zs = zhs.zhs_zstream;
+
+  // While there is something to decode
+  while (slLen > 0)
+  {
+    // If zlib has no more input
+    while (zs.avail_in == 0) {
+      // [Cecil] Entire input from the mapping has been used up
+      if (zhs.zhs_pMapping != NULL) {
+        return FALSE;
+      }
+
+      // Read more to it
+      SLONG slRead = fread(zhs.zhs_pubBufIn, 1, BUF_SIZE, zhs.zhs_fFile);
+
+      if (slRead <= 0) {
+        return FALSE;
+      }
+
+      // Tell zlib that there is more to read
+      zs.next_in = zhs.zhs_pubBufIn;
+      zs.avail_in = slRead;
+    }
+
+    SLONG slChunk = slLen;
+
+    // Stop at the next checkpoint
+    if (zhs.zhs_ulNextCheckpoint > zs.total_out) {
+      slChunk = Min(slChunk, SLONG(zhs.zhs_ulNextCheckpoint - zs.total_out));
+    }
+
+    // Decode to output
+    if (pubOut != NULL) {
+      zs.next_out = pubOut;
+
+    // Decode into the scratch buffer
+    } else {
+      if (zhs.zhs_pubScratch == NULL) {
+        zhs.zhs_pubScratch = (UBYTE *)AllocMemory(ZIP_SCRATCH_SIZE);
+      }
+
+      slChunk = Min(slChunk, SLONG(ZIP_SCRATCH_SIZE));
+      zs.next_out = zhs.zhs_pubScratch;
+    }
+
+    zs.avail_out = slChunk;
+
+    int iErr = inflate(&zs, Z_SYNC_FLUSH);
+
+    if (iErr != Z_OK && iErr != Z_STREAM_END) {
+      zhs.Throw_t(iErr, strError);
+    }
+
+    const SLONG slDecoded = slChunk - zs.avail_out;
+    slLen -= slDecoded;
+
+    if (pubOut != NULL) {
+      pubOut += slDecoded;
+    }
+
+    // Reached the next checkpoint
+    if (zhs.zhs_ulNextCheckpoint != 0 && zs.total_out >= zhs.zhs_ulNextCheckpoint) {
+      zhs.TakeCheckpoint();
+    }
+
+    // No more data
+    if (iErr == Z_STREAM_END) {
+      return (slLen == 0);
+    }
+  }
+
+  return TRUE;
+};
+
 // Read a block from ZIP file
 void ReadBlock_t(INDEX iHandle, UBYTE *pub, SLONG slStart, SLONG slLen)
 {
-  if (!VerifyHandle(iHandle)) return;
+  CZipHandleState *pzhs;
 
-  CZipHandle &zh = _aZipHandles[iHandle];
+  // [Cecil] Only look up the handle under the global lock
+  {
+    CTSingleLock slZip(_pcsZipLock, TRUE);
+
+    if (!VerifyHandle(iHandle)) return;
+
+    pzhs = _apZipHandleStates[iHandle];
+  }
+
+  // [Cecil] Read the handle under its own lock
+  CZipHandleState &zhs = *pzhs;
+  CTSingleLock slHandle(&zhs.zhs_csLock, TRUE);
+
+  const CZipEntry &ze = zhs.zhs_zeEntry;
 
   // Over the end of file
-  if (slStart >= zh.zh_zeEntry.ze_slUncompressedSize) {
+  if (slStart >= ze.ze_slUncompressedSize) {
     return;
   }
 
   // Clamp length to end of the entry data
-  slLen = Min(slLen, zh.zh_zeEntry.ze_slUncompressedSize - slStart);
+  slLen = Min(slLen, ze.ze_slUncompressedSize - slStart);
+
+  // [Cecil] Copy from the cached data
+  if (zhs.zhs_pCached != NULL) {
+    memcpy(pub, zhs.zhs_pCached->zce_pubData + slStart, slLen);
+    return;
+  }
 
   // If not compressed
-  if (zh.zh_zeEntry.ze_bStored) {
+  if (ze.ze_bStored) {
     // Just read from file
-    fseek(zh.zh_fFile, zh.zh_zeEntry.ze_slDataOffset+slStart, SEEK_SET);
-    fread(pub, 1, slLen, zh.zh_fFile);
+    zhs.ReadArchive(ze.ze_slDataOffset + slStart, pub, slLen);
     return;
   }
 
-  CTSingleLock slZip(_pcsZipLock, TRUE);
+  z_stream &zs = zhs.zhs_zstream;
 
-  // If behind the current pointer
-  if (slStart < zh.zh_zstream.total_out) {
-    // Reset the zlib stream to beginning
-    inflateReset(&zh.zh_zstream);
-    zh.zh_zstream.avail_in = 0;
-    zh.zh_zstream.next_in = NULL;
+  // [Cecil] Find the closest checkpoint before the position
+  const INDEX iCheckpoint = zhs.FindCheckpoint(slStart);
+  const ULONG ulCheckpoint = (iCheckpoint != -1) ? zhs.zhs_aCheckpoints[iCheckpoint].total_out : 0;
 
-    // Seek to start of zip entry data inside archive
-    fseek(zh.zh_fFile, zh.zh_zeEntry.ze_slDataOffset, SEEK_SET);
-  }
+  // If behind the current pointer or if there's a checkpoint closer to it
+  if (slStart < zs.total_out || ulCheckpoint > zs.total_out) {
+  #if ZIP_SEEK_CHECKPOINTS
+    // [Cecil] Resume from the checkpoint
+    if (iCheckpoint != -1) {
+      z_stream &zsCheckpoint = zhs.zhs_aCheckpoints[iCheckpoint];
 
-  // While ahead of the current pointer
-  while (slStart > zh.zh_zstream.total_out)
-  {
-    // If zlib has no more input
-    while (zh.zh_zstream.avail_in == 0) {
-      // Read more to it
-      SLONG slRead = fread(zh.zh_pubBufIn, 1, BUF_SIZE, zh.zh_fFile);
+      inflateEnd(&zs);
+      int iErr = inflateCopy(&zs, &zsCheckpoint);
 
-      if (slRead <= 0) {
-        return;
+      if (iErr != Z_OK) {
+        zhs.Throw_t(iErr, LOCALIZE("Error seeking in zip"));
       }
 
-      // Tell zlib that there is more to read
-      zh.zh_zstream.next_in = zh.zh_pubBufIn;
-      zh.zh_zstream.avail_in = slRead;
-    }
-
-    // Read dummy data from the output
-    #define DUMMY_SIZE 256
-    UBYTE aubDummy[DUMMY_SIZE];
+      // Continue from the compressed data of the checkpoint
+      zhs.RewindInput(zsCheckpoint.total_in);
 
-    // Decode to output
-    zh.zh_zstream.avail_out = Min(SLONG(slStart-zh.zh_zstream.total_out), SLONG(DUMMY_SIZE));
-    zh.zh_zstream.next_out = aubDummy;
+    } else
+  #endif
+    {
+      // Reset the zlib stream to beginning
+      inflateReset(&zs);
 
-    int iErr = inflate(&zh.zh_zstream, Z_SYNC_FLUSH);
+      // Seek to start of zip entry data inside archive
+      zhs.RewindInput(0);
+    }
+  }
 
-    if (iErr != Z_OK && iErr != Z_STREAM_END) {
-      zh.Throw_t(iErr, LOCALIZE("Error seeking in zip"));
+  // While ahead of the current pointer
+  if (slStart > zs.total_out) {
+    // Skip decompressed data
+    if (!InflateData_t(zhs, NULL, slStart - zs.total_out, LOCALIZE("Error seeking in zip"))) {
+      return;
     }
   }
 
   // If not streaming continuously
-  if (slStart != zh.zh_zstream.total_out) {
+  if (slStart != zs.total_out) {
     // This should not happen
     ASSERT(FALSE);
 
@@ -808,43 +2509,39 @@ void ReadBlock_t(INDEX iHandle, UBYTE *pub, SLONG slStart, SLONG slLen)
     return;
   }
 
-  // Set zlib for writing to the block
-  zh.zh_zstream.avail_out = slLen;
-  zh.zh_zstream.next_out = pub;
-
-  // While there is something to write to given block
-  while (zh.zh_zstream.avail_out > 0)
-  {
-    // If zlib has no more input
-    while (zh.zh_zstream.avail_in == 0) {
-      // Read more to it
-      SLONG slRead = fread(zh.zh_pubBufIn, 1, BUF_SIZE, zh.zh_fFile);
-
-      if (slRead <= 0) {
-        return;
-      }
-
-      // Tell zlib that there is more to read
-      zh.zh_zstream.next_in = zh.zh_pubBufIn;
-      zh.zh_zstream.avail_in = slRead;
-    }
-
-    // Decode to output
-    int iErr = inflate(&zh.zh_zstream, Z_SYNC_FLUSH);
-
-    if (iErr != Z_OK && iErr != Z_STREAM_END) {
-      zh.Throw_t(iErr, LOCALIZE("Error reading from zip"));
-    }
-  }
+  // Decode into the given block
+  InflateData_t(zhs, pub, slLen, LOCALIZE("Error reading from zip"));
 };
 
 // Close a ZIP file entry
 void Close(INDEX iHandle)
 {
-  if (!VerifyHandle(iHandle)) return;
+  {
+    CTSingleLock slZip(_pcsZipLock, TRUE);
+    if (!VerifyHandle(iHandle)) return;
+  }
 
   // Clear it
-  _aZipHandles[iHandle].Clear();
+  ReleaseHandle(iHandle);
+};
+
+// [Cecil] Declare shell symbols for archive handling
+void RegisterSymbols(void)
+{
+  _pShell->DeclareSymbol("persistent user INDEX fil_iZipCheckpointKB;",       &fil_iZipCheckpointKB);
+  _pShell->DeclareSymbol("persistent user INDEX fil_iZipCheckpointBudgetKB;", &fil_iZipCheckpointBudgetKB);
+
+  _pShell->DeclareSymbol("persistent user INDEX fil_bZipMapArchives;", &fil_bZipMapArchives);
+  _pShell->DeclareSymbol("persistent user INDEX fil_iZipMapBudgetMB;", &fil_iZipMapBudgetMB);
+
+  _pShell->DeclareSymbol("persistent user INDEX fil_bZipEntryCache;",    &fil_bZipEntryCache);
+  _pShell->DeclareSymbol("persistent user INDEX fil_iZipCacheEntryKB;",  &fil_iZipCacheEntryKB);
+  _pShell->DeclareSymbol("persistent user INDEX fil_iZipCacheBudgetKB;", &fil_iZipCacheBudgetKB);
+
+  _pShell->DeclareSymbol("const INDEX fil_ctZipCacheHits;",    (void *)&fil_ctZipCacheHits);
+  _pShell->DeclareSymbol("const INDEX fil_ctZipCacheMisses;",  (void *)&fil_ctZipCacheMisses);
+  _pShell->DeclareSymbol("const INDEX fil_ctZipCacheEntries;", (void *)&fil_ctZipCacheEntries);
+  _pShell->DeclareSymbol("const INDEX fil_iZipCacheUsedKB;",   (void *)&fil_iZipCacheUsedKB);
 };
 
 }; // namespace
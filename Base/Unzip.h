@@ -67,6 +67,9 @@ CORE_API const CTFileName &GetFileAtIndex(INDEX i);
 // Check if specific file is from a mod
 CORE_API BOOL IsFileAtIndexMod(INDEX i);
 
+// [Cecil] Get indices of files under some directory
+CORE_API void ListDirectory(CStaticStackArray<INDEX> &aiFiles, const CTString &strDir, BOOL bRecursive);
+
 // Get index of a specific file (-1 if no file)
 CORE_API INDEX GetFileIndex(const CTFileName &fnm);
 
@@ -97,6 +100,9 @@ CORE_API void ReadBlock_t(INDEX iHandle, UBYTE *pub, SLONG slStart, SLONG slLen)
 // Close a ZIP file entry
 CORE_API void Close(INDEX iHandle);
 
+// [Cecil] Declare shell symbols for archive handling
+void RegisterSymbols(void);
+
 }; // namespace
 
 #endif
@@ -45,34 +45,43 @@ void CActionBuffer::Clear(void) {
   }
 };
 
-static int qsort_CompareActions(const void *elem1, const void *elem2) {
-  const CActionEntry &ae1 = **(CActionEntry **)elem1;
-  const CActionEntry &ae2 = **(CActionEntry **)elem2;
-  return ae1.ae_pa.pa_llCreated-ae2.ae_pa.pa_llCreated;
-};
-
 // Add a new action to the buffer
 void CActionBuffer::AddAction(const CPlayerAction &pa) {
-  // Search all buffered actions
-  FOREACHINLIST(CActionEntry, ae_ln, ab_lhActions, itae) {
-    CActionEntry &ae = *itae;
-
-    // If this is the one
-    if (ae.ae_pa.pa_llCreated == pa.pa_llCreated) {
-      // Skip adding it again
-      return;
+  // [Cecil] Actions are kept sorted, so look for an older action starting from the newest one
+  // (which is usually the last one) instead of sorting the entire list after adding
+  CActionEntry *paeOlder = NULL;
+
+  if (!ab_lhActions.IsEmpty()) {
+    CActionEntry *pae = LIST_TAIL(ab_lhActions, CActionEntry, ae_ln);
+
+    while (TRUE) {
+      // If this is the one
+      if (pae->ae_pa.pa_llCreated == pa.pa_llCreated) {
+        // Skip adding it again
+        return;
+      }
+
+      // Found an older action
+      if (pae->ae_pa.pa_llCreated < pa.pa_llCreated) {
+        paeOlder = pae;
+        break;
+      }
+
+      if (pae->ae_ln.IsHead()) break;
+      pae = LIST_PRED(*pae, CActionEntry, ae_ln);
     }
   }
 
-  // Add to the tail
-  CActionEntry *pae = new CActionEntry;
-  pae->ae_pa = pa;
-
-  ab_lhActions.AddTail(pae->ae_ln);
+  CActionEntry *paeNew = new CActionEntry;
+  paeNew->ae_pa = pa;
 
-  // Sort the list
-  ab_lhActions.Sort(&qsort_CompareActions, offsetof(CActionEntry, ae_ln));
-}
+  // Add right after the older action or in the beginning
+  if (paeOlder != NULL) {
+    paeOlder->ae_ln.AddAfter(paeNew->ae_ln);
+  } else {
+    ab_lhActions.AddHead(paeNew->ae_ln);
+  }
+};
 
 // Flush all actions up to given time tag
 void CActionBuffer::FlushUntilTime(__int64 llNewest) {
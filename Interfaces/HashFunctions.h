@@ -0,0 +1,67 @@
+/* Copyright (c) 2024 Dreamy Cecil
+This program is free software; you can redistribute it and/or modify
+it under the terms of version 2 of the GNU General Public License as published by
+the Free Software Foundation
+
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#ifndef CECIL_INCL_HASHFUNCTIONS_H
+#define CECIL_INCL_HASHFUNCTIONS_H
+
+#ifdef PRAGMA_ONCE
+  #pragma once
+#endif
+
+#include <ctype.h>
+
+// Interface of methods for hashing keys of lookup tables (32-bit FNV-1a)
+namespace IHash {
+
+// Initial hash value
+static const ULONG ulInitial = 2166136261UL;
+
+// Mix one byte into the hash
+inline ULONG Byte(ULONG ulHash, UBYTE ub) {
+  return (ulHash ^ ub) * 16777619UL;
+};
+
+// Mix one character into the hash case-insensitively
+inline ULONG CharNoCase(ULONG ulHash, char ch) {
+  // Cast before converting because negative characters are undefined behavior in toupper()
+  return Byte(ulHash, (UBYTE)toupper((UBYTE)ch));
+};
+
+// Get hash of raw data
+inline ULONG Data(const void *pData, size_t ctBytes) {
+  const UBYTE *pub = (const UBYTE *)pData;
+  ULONG ulHash = ulInitial;
+
+  for (size_t i = 0; i < ctBytes; i++) {
+    ulHash = Byte(ulHash, pub[i]);
+  }
+
+  return ulHash;
+};
+
+// Get case-insensitive hash of a string
+inline ULONG StringNoCase(const char *str) {
+  ULONG ulHash = ulInitial;
+
+  for (; *str != '\0'; str++) {
+    ulHash = CharNoCase(ulHash, *str);
+  }
+
+  return ulHash;
+};
+
+}; // namespace
+
+#endif
@@ -74,33 +74,8 @@ inline BOOL ReplaceFile(const CTFileName &fnmSourceFile, CTFileName &fnmReplacem
 
   const CTString strBaseFile("Data\\BaseForReplacingFiles.txt");
 
-  // Try to find a replacement in the base file
-  try {
-    char strLine[256];
-    char strSource[256];
-    char strRemap[256];
-
-    // Read list with file remaps
-    CTFileStream strm;
-    strm.Open_t(strBaseFile);
-
-    while (!strm.AtEOF()) {
-      IData::GetLineFromStream_t(strm, strLine, 256);
-      sscanf(strLine, "\"%[^\"]\" \"%[^\"]\"", strSource, strRemap);
-
-      // Skip remapping to itself
-      if (CTString(strSource) ==  strRemap) continue;
-
-      // Get remapped file
-      if (strSource == fnmSourceFile) {
-        fnmReplacement = CTString(strRemap);
-        return TRUE;
-      }
-    }
-
-  } catch (char *strError) {
-    (void)strError;
-  }
+  // [Cecil] Try to find a replacement in the base file
+  if (FindFileReplacement(fnmSourceFile, fnmReplacement)) return TRUE;
 
   // No replacement found
   if (bReadOnly) return FALSE;
@@ -17,7 +17,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "ExtPackets.h"
 #include "NetworkFunctions.h"
+#include "Modules/ActiveClients.h"
 #include "Modules/PacketCommands.h"
+#include "Interfaces/HashFunctions.h"
 
 #define VANILLA_EVENTS_ENTITY_ID
 #include <Extras/XGizmo/Vanilla/EntityEvents.h>
@@ -27,6 +29,54 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 // Report packet actions to the server
 INDEX ser_bReportExtPacketLogic = TRUE;
 
+// Default placement coding for entity placement packets
+INDEX ser_iPlacementCoding = k_EPlacementCoding_Raw;
+
+// Fractional bits of quantized positions and rotation angles in entity placement packets
+INDEX ser_iPlacementPosBits = 6;
+INDEX ser_iPlacementAngleBits = 6;
+
+// Queue packets for clients during a tick and send them in one block, if all clients support it
+INDEX ser_bBatchExtPackets = FALSE;
+
+// Size of queued packets in bytes after which they are sent right away
+INDEX ser_iExtBatchSize = 1024;
+
+// Packets queued for clients since the last batch as submessages
+static CNetworkMessage *_pnmBatch = NULL;
+static ULONG _ctBatchRecords = 0;
+static BOOL _bBatchPatchFormat = FALSE;
+
+// Defer packets of lower priorities until they fit into the bandwidth of the slowest client
+INDEX ser_bQueueExtPackets = FALSE;
+
+// Share of the slowest client's bandwidth that packets for clients can take up each tick
+FLOAT ser_fExtQueueBandwidth = 0.25f;
+
+// Time in seconds after which deferred packets are sent regardless of the bandwidth
+FLOAT ser_fExtQueueMaxDelay = 1.0f;
+
+// Maximum amount of deferred packets
+INDEX ser_iExtQueueMaxPackets = 256;
+
+// Size of packets sent to clients since the last tick
+static SLONG _slSentThisTick = 0;
+
+static void SendAllQueuedPackets(void);
+static BOOL OutdatesQueuedPackets(ULONG ulType);
+static BOOL CanDeferPacket(IClassicsExtPacket *pExtPacket);
+
+// Packets are being written or read in the format of this patch version instead of the legacy one
+BOOL CExtPacket::_bPatchFormat = FALSE;
+
+// Entity positions and rotations sent by the server since the last client has started joining
+CExtPacket::CBaselines CExtEntityPacket::_mapSentPos;
+CExtPacket::CBaselines CExtEntityPacket::_mapSentRot;
+
+// Entity positions and rotations read from the game stream
+CExtPacket::CBaselines CExtEntityPacket::_mapReadPos;
+CExtPacket::CBaselines CExtEntityPacket::_mapReadRot;
+
 void ClassicsPackets_ServerReport(IClassicsExtPacket *pExtPacket, const char *strFormat, ...)
 {
   // Ignore reports
@@ -48,14 +98,37 @@ void ClassicsPackets_SendToClients(IClassicsExtPacket *pExtPacket)
   // Not running a server
   if (!_pNetwork->IsServer()) return;
 
+  const ULONG ulType = pExtPacket->GetType();
+
+  // [Cecil] Send it later when there's enough bandwidth
+  if (ser_bQueueExtPackets && CanDeferPacket(pExtPacket)) {
+    CExtPacket::AddToQueue(pExtPacket);
+    return;
+  }
+
+  // [Cecil] Deferred packets cannot refer to entities and worlds that are about to be gone
+  if (OutdatesQueuedPackets(ulType)) {
+    SendAllQueuedPackets();
+  }
+
+  // [Cecil] Send it later with other packets
+  if (ser_bBatchExtPackets) {
+    CExtPacket::AddToBatch(pExtPacket);
+    return;
+  }
+
+  // [Cecil] Send queued packets before this one
+  CExtPacket::FlushBatch();
+
   // Remember last value
   INDEX &iLastSequence = _pNetwork->ga_srvServer.srv_iLastProcessedSequence;
   const INDEX iLastValue = iLastSequence;
 
-  CNetStreamBlock nsbExt = INetwork::CreateServerPacket(pExtPacket->GetType());
+  CNetStreamBlock nsbExt = INetwork::CreateServerPacket(ulType);
 
   if (pExtPacket->Write(nsbExt)) {
     INetwork::AddBlockToAllSessions(nsbExt);
+    _slSentThisTick += nsbExt.nm_slSize;
 
   // Restore the value since the packet has been discarded
   } else {
@@ -184,6 +257,99 @@ void ClassicsPackets_Destroy(IClassicsBuiltInExtPacket *pExtPacket) {
   delete pExtPacket;
 };
 
+// Write vector using some placement coding against a baseline from the map (if any)
+void CExtPacket::WriteCodedVector(CNetworkMessage &nm, const FLOAT3D &v, INDEX iCoding, BOOL bRotation, CBaselines *pmap, ULONG ulEntity) {
+  // Clients may not know about placement coding
+  if (!_bPatchFormat) {
+    if (bRotation) {
+      INetCompress::Angle3D(nm, v);
+    } else {
+      INetCompress::Float3D(nm, v);
+    }
+    return;
+  }
+
+  const INDEX iBits = (bRotation ? ser_iPlacementAngleBits : ser_iPlacementPosBits);
+  const UBYTE ubBits = (UBYTE)Clamp(iBits, (INDEX)0, (INDEX)20);
+
+  const FLOAT3D *pvBase = NULL;
+
+  if (pmap != NULL) {
+    CBaselines::const_iterator it = pmap->find(ulEntity);
+
+    if (it != pmap->end()) {
+      pvBase = &it->second;
+    }
+  }
+
+  FLOAT3D vCoded;
+  INetCompress::CodedFloat3D(nm, v, iCoding, ubBits, pvBase, vCoded);
+
+  // Remember the value that clients will have
+  if (pmap != NULL) {
+    (*pmap)[ulEntity] = vCoded;
+  }
+};
+
+// Read vector written using any placement coding against a baseline from the map (if any)
+BOOL CExtPacket::ReadCodedVector(CNetworkMessage &nm, FLOAT3D &v, BOOL bRotation, CBaselines *pmap, ULONG ulEntity) {
+  // Legacy format without any coding
+  if (!_bPatchFormat) {
+    if (bRotation) {
+      INetDecompress::Angle3D(nm, v);
+    } else {
+      INetDecompress::Float3D(nm, v);
+    }
+    return TRUE;
+  }
+
+  const FLOAT3D *pvBase = NULL;
+
+  if (pmap != NULL) {
+    CBaselines::const_iterator it = pmap->find(ulEntity);
+
+    if (it != pmap->end()) {
+      pvBase = &it->second;
+    }
+  }
+
+  if (!INetDecompress::CodedFloat3D(nm, v, pvBase)) {
+    CPrintF(TRANS("[%s] Received a delta for entity %u without a baseline!\n"), GetName(), ulEntity);
+    return FALSE;
+  }
+
+  if (pmap != NULL) {
+    (*pmap)[ulEntity] = v;
+  }
+
+  return TRUE;
+};
+
+// Forget sent and/or read baselines for delta coding
+void CExtEntityPacket::ResetBaselines(BOOL bSent, BOOL bRead) {
+  if (bSent) {
+    _mapSentPos = CBaselines();
+    _mapSentRot = CBaselines();
+  }
+
+  if (bRead) {
+    _mapReadPos = CBaselines();
+    _mapReadRot = CBaselines();
+  }
+};
+
+// Get baselines for delta coding of an absolute vector of this entity (none if can't be used)
+CExtPacket::CBaselines *CExtEntityPacket::GetBaselines(BOOL bSent, BOOL bRotation) {
+  // Last created entity has no stable ID
+  if (!IsEntityValid() || props[k_EField_ulEntity].GetIndex() == 0) return NULL;
+
+  if (bSent) {
+    return (bRotation ? &_mapSentRot : &_mapSentPos);
+  }
+
+  return (bRotation ? &_mapReadRot : &_mapReadPos);
+};
+
 // Retrieve an entity from an ID
 CEntity *CExtEntityPacket::FindExtEntity(ULONG ulID) {
   // Take last created entity if ID is 0
@@ -203,7 +369,7 @@ CEntity *CExtEntityPacket::GetEntity(void) {
     return NULL;
   }
 
-  const ULONG ulEntity = props["ulEntity"].GetIndex();
+  const ULONG ulEntity = props[k_EField_ulEntity].GetIndex();
   CEntity *pen = FindExtEntity(ulEntity);
 
   if (pen == NULL) {
@@ -214,36 +380,130 @@ CEntity *CExtEntityPacket::GetEntity(void) {
   return pen;
 };
 
+// Compare field names (case-insensitive)
+static inline BOOL SameFieldName(const char *str1, const char *str2) {
+  for (; *str1 != '\0' && *str2 != '\0'; str1++, str2++) {
+    if (toupper((UBYTE)*str1) != toupper((UBYTE)*str2)) return FALSE;
+  }
+
+  return (*str1 == *str2);
+};
+
+CExtPacketLayout::CExtPacketLayout(const char **astrSetNames, INDEX ctSetFields) :
+  astrNames(astrSetNames), ctFields(ctSetFields)
+{
+  ASSERT(ctFields <= EXTPACKET_MAXFIELDS);
+  memset(aubLookup, 0xFF, sizeof(aubLookup));
+
+  const ULONG ulMask = ARRAYCOUNT(aubLookup) - 1;
+
+  for (INDEX i = 0; i < ctFields; i++) {
+    ASSERT(astrNames[i] != NULL);
+    ULONG ulSlot = IHash::StringNoCase(astrNames[i]) & ulMask;
+
+    // Take the next free slot
+    while (aubLookup[ulSlot] != 0xFF) {
+      ulSlot = (ulSlot + 1) & ulMask;
+    }
+
+    aubLookup[ulSlot] = (UBYTE)i;
+  }
+};
+
+// Find field index by its name (-1 if it doesn't exist)
+INDEX CExtPacketLayout::Find(const char *strName) const {
+  const ULONG ulMask = ARRAYCOUNT(aubLookup) - 1;
+  ULONG ulSlot = IHash::StringNoCase(strName) & ulMask;
+
+  while (aubLookup[ulSlot] != 0xFF) {
+    const INDEX iField = aubLookup[ulSlot];
+    if (SameFieldName(astrNames[iField], strName)) return iField;
+
+    ulSlot = (ulSlot + 1) & ulMask;
+  }
+
+  return -1;
+};
+
+// Field names of each packet type in the order of their field indices
+static const char *_astrEntityPacketFields[] = { "ulEntity" };
+static const char *_astrEntityCreateFields[] = { "fnmClass", "plPos" };
+static const char *_astrEntityDeleteFields[] = { "ulEntity", "bSameClass" };
+static const char *_astrEntityCopyFields[] = { "ulEntity", "iCopies" };
+static const char *_astrEntityTeleportFields[] = { "ulEntity", "plSet", "bRelative", "iCoding" };
+static const char *_astrEntityPositionFields[] = { "ulEntity", "vSet", "bRotation", "bRelative", "iCoding" };
+static const char *_astrEntityParentFields[] = { "ulEntity", "ulParent" };
+static const char *_astrEntityPropFields[] = { "ulEntity", "bName", "ulProp", "value" };
+static const char *_astrEntityHealthFields[] = { "ulEntity", "fHealth" };
+static const char *_astrEntityFlagsFields[] = { "ulEntity", "ulFlags", "iType", "bRemove" };
+static const char *_astrEntityMoveFields[] = { "ulEntity", "vSpeed" };
+static const char *_astrEntityDirDmgFields[] = { "ulEntity", "eDamageType", "fDamage", "ulTarget", "vHitPoint", "vDirection" };
+static const char *_astrEntityRadDmgFields[] = { "ulEntity", "eDamageType", "fDamage", "vCenter", "fFallOff", "fHotSpot" };
+static const char *_astrEntityBoxDmgFields[] = { "ulEntity", "eDamageType", "fDamage", "boxArea" };
+static const char *_astrChangeLevelFields[] = { "strWorld" };
+static const char *_astrSessionPropsFields[] = { "iSize", "iOffset" };
+static const char *_astrGameplayExtFields[] = { "iVar", "value" };
+
+static const char *_astrPlaySoundFields[] = {
+  "strFile", "iChannel", "ulFlags", "fDelay", "fOffset",
+  "fVolumeL", "fVolumeR", "fFilterL", "fFilterR", "fPitch",
+};
+
+EXTPACKET_DEFINELAYOUT(CExtEntityPacket, _astrEntityPacketFields);
+EXTPACKET_DEFINELAYOUT(CExtEntityCreate, _astrEntityCreateFields);
+EXTPACKET_DEFINELAYOUT(CExtEntityDelete, _astrEntityDeleteFields);
+EXTPACKET_DEFINELAYOUT(CExtEntityCopy, _astrEntityCopyFields);
+EXTPACKET_DEFINELAYOUT(CExtEntityTeleport, _astrEntityTeleportFields);
+EXTPACKET_DEFINELAYOUT(CExtEntityPosition, _astrEntityPositionFields);
+EXTPACKET_DEFINELAYOUT(CExtEntityParent, _astrEntityParentFields);
+EXTPACKET_DEFINELAYOUT(CExtEntityProp, _astrEntityPropFields);
+EXTPACKET_DEFINELAYOUT(CExtEntityHealth, _astrEntityHealthFields);
+EXTPACKET_DEFINELAYOUT(CExtEntityFlags, _astrEntityFlagsFields);
+EXTPACKET_DEFINELAYOUT(CExtEntityMove, _astrEntityMoveFields);
+EXTPACKET_DEFINELAYOUT(CExtEntityDirectDamage, _astrEntityDirDmgFields);
+EXTPACKET_DEFINELAYOUT(CExtEntityRangeDamage, _astrEntityRadDmgFields);
+EXTPACKET_DEFINELAYOUT(CExtEntityBoxDamage, _astrEntityBoxDmgFields);
+EXTPACKET_DEFINELAYOUT(CExtChangeLevel, _astrChangeLevelFields);
+EXTPACKET_DEFINELAYOUT(CExtSessionProps, _astrSessionPropsFields);
+EXTPACKET_DEFINELAYOUT(CExtGameplayExt, _astrGameplayExtFields);
+EXTPACKET_DEFINELAYOUT(CExtPlaySound, _astrPlaySoundFields);
+
 // Convenient value getter
-CAnyValue *CExtPacket::GetValue(const CTString &strVariable) {
-  se1::map<CTString, CAnyValue>::iterator it = props.find(strVariable);
+CAnyValue *CExtPacket::GetValue(const char *strVariable) {
+  const INDEX iField = GetLayout().Find(strVariable);
 
-  if (it == props.end()) {
+  if (iField == -1) {
     PACKET_PROP_WARNING(this, strVariable, "Property doesn't exist!");
     return NULL;
   }
 
-  return &it->second;
+  return &props[iField];
 };
 
 // Convenient value setter
-bool CExtPacket::operator()(const CTString &strVariable, const CAnyValue &val) {
-  se1::map<CTString, CAnyValue>::iterator it = props.find(strVariable);
-
-  if (it == props.end()) {
-    PACKET_PROP_WARNING(this, strVariable, "Property doesn't exist!");
-    return false;
-  }
+bool CExtPacket::operator()(const char *strVariable, const CAnyValue &val) {
+  CAnyValue *pval = GetValue(strVariable);
+  if (pval == NULL) return false;
 
-  if (it->second.GetType() != val.GetType()) {
-    PACKET_PROP_WARNING(this, strVariable, CTString(0, "Cannot set value! Expected type %d but got %d!", it->second.GetType(), val.GetType()));
+  if (pval->GetType() != val.GetType()) {
+    PACKET_PROP_WARNING(this, strVariable, CTString(0, "Cannot set value! Expected type %d but got %d!", pval->GetType(), val.GetType()));
     return false;
   }
 
-  it->second = val;
+  *pval = val;
   return true;
 };
 
+// Convenient value getter (for plugins built against older headers)
+CAnyValue *CExtPacket::GetValue(const CTString &strVariable) {
+  return GetValue(strVariable.str_String);
+};
+
+// Convenient value setter (for plugins built against older headers)
+bool CExtPacket::operator()(const CTString &strVariable, const CAnyValue &val) {
+  return (*this)(strVariable.str_String, val);
+};
+
 // Create new packet from type
 CExtPacket *CExtPacket::CreatePacket(EPacketType ePacket)
 {
@@ -283,6 +543,461 @@ CExtPacket *CExtPacket::CreatePacket(EPacketType ePacket)
   return NULL;
 };
 
+// Write packet exactly like it would be sent on its own but without a sequence number
+static BOOL WriteRecord(IClassicsExtPacket *pExtPacket, CNetworkMessage &nmRecord, BOOL bPatchFormat) {
+  INetCompress::Integer(nmRecord, pExtPacket->GetType());
+
+  CExtPacket::_bPatchFormat = bPatchFormat;
+  const BOOL bWritten = pExtPacket->Write(nmRecord);
+  CExtPacket::_bPatchFormat = FALSE;
+
+  return bWritten;
+};
+
+// Queue written packet for clients to send it later in a batch
+static void AddRecordToBatch(CNetworkMessage &nmRecord, BOOL bPatchFormat) {
+  // Make sure the batch can fit into one network message
+  const SLONG slMaxSize = Clamp(ser_iExtBatchSize, (INDEX)64, (INDEX)1400);
+
+  // All packets in a batch are written in the same format
+  if (_pnmBatch != NULL && (_pnmBatch->nm_slSize + nmRecord.nm_slSize > slMaxSize || _bBatchPatchFormat != bPatchFormat)) {
+    CExtPacket::FlushBatch();
+  }
+
+  if (_pnmBatch == NULL) {
+    _pnmBatch = new CNetworkMessage((MESSAGETYPE)INetwork::PCK_EXTENSION_BATCH);
+    _bBatchPatchFormat = bPatchFormat;
+  }
+
+  _pnmBatch->InsertSubMessage(nmRecord);
+  _ctBatchRecords++;
+  _slSentThisTick += nmRecord.nm_slSize;
+
+  // Send big batches right away
+  if (_pnmBatch->nm_slSize >= slMaxSize) {
+    CExtPacket::FlushBatch();
+  }
+};
+
+// Check if all clients that receive the game stream can unpack batches
+static BOOL CanSendBatches(void) {
+  CServer &srv = _pNetwork->ga_srvServer;
+  const INDEX ctSessions = srv.srv_assoSessions.Count();
+
+  // Server client always runs the same patch
+  for (INDEX i = 1; i < ctSessions; i++) {
+    if (srv.srv_assoSessions[i].IsActive() && !_aActiveClients[i].bPatchClient) return FALSE;
+  }
+
+  return TRUE;
+};
+
+// Queue packet for clients to send it later in a batch
+void CExtPacket::AddToBatch(IClassicsExtPacket *pExtPacket) {
+  CNetworkMessage nmRecord((MESSAGETYPE)INetwork::PCK_EXTENSION);
+
+  // Use the patch format only if the batch can be sent as is
+  const BOOL bPatchFormat = CanSendBatches();
+
+  // Discard the packet
+  if (!WriteRecord(pExtPacket, nmRecord, bPatchFormat)) return;
+
+  AddRecordToBatch(nmRecord, bPatchFormat);
+};
+
+// Send all queued packets to clients (as one block, if all clients support it)
+void CExtPacket::FlushBatch(void) {
+  if (_ctBatchRecords == 0) return;
+
+  CServer &srv = _pNetwork->ga_srvServer;
+
+  // Read queued packets from the beginning
+  CNetworkMessage &nmBatch = *_pnmBatch;
+  nmBatch.Rewind();
+
+  if (CanSendBatches()) {
+    // Amount of packets and their format followed by the packets themselves
+    CNetStreamBlock nsbBatch(INetwork::PCK_EXTENSION_BATCH, ++srv.srv_iLastProcessedSequence);
+    INetCompress::Integer(nsbBatch, _ctBatchRecords);
+
+    UBYTE ubPatchFormat = (UBYTE)_bBatchPatchFormat;
+    nsbBatch.WriteBits(&ubPatchFormat, 1);
+
+    for (ULONG i = 0; i < _ctBatchRecords; i++) {
+      CNetworkMessage nmRecord;
+      nmBatch.ExtractSubMessage(nmRecord);
+      nsbBatch.InsertSubMessage(nmRecord);
+    }
+
+    INetwork::AddBlockToAllSessions(nsbBatch);
+
+  } else {
+    // Batches in the patch format are sent before clients without the patch start receiving the game stream
+    ASSERT(!_bBatchPatchFormat);
+
+    // Send each packet in its own block for clients without batch support
+    for (ULONG i = 0; i < _ctBatchRecords; i++) {
+      CNetworkMessage nmRecord;
+      nmBatch.ExtractSubMessage(nmRecord);
+
+      CNetStreamBlock nsbExt(nmRecord, ++srv.srv_iLastProcessedSequence);
+      INetwork::AddBlockToAllSessions(nsbExt);
+    }
+  }
+
+  ResetBatch();
+};
+
+// Discard all queued packets
+void CExtPacket::ResetBatch(void) {
+  if (_pnmBatch != NULL) {
+    delete _pnmBatch;
+    _pnmBatch = NULL;
+  }
+
+  _ctBatchRecords = 0;
+  _bBatchPatchFormat = FALSE;
+};
+
+// Send written packet to clients right away or with other packets
+static void SendRecord(CNetworkMessage &nmRecord) {
+  if (ser_bBatchExtPackets) {
+    AddRecordToBatch(nmRecord, FALSE);
+    return;
+  }
+
+  // Send queued packets before this one
+  CExtPacket::FlushBatch();
+
+  CServer &srv = _pNetwork->ga_srvServer;
+
+  CNetStreamBlock nsbExt(nmRecord, ++srv.srv_iLastProcessedSequence);
+  INetwork::AddBlockToAllSessions(nsbExt);
+  _slSentThisTick += nsbExt.nm_slSize;
+};
+
+// Packet for clients deferred until there's enough bandwidth for it
+struct SQueuedPacket {
+  CNetworkMessage *pnmRecord; // Written packet without a sequence number
+  ULONG ulType;
+  ULONG ulEntity; // Entity for coalescing packets (0x7FFFFFFF if none)
+  CTimerValue tvQueued;
+};
+
+// Delivery of deferred packets of one priority
+struct SQueueStats {
+  ULONG ctSent;
+  ULONG ctCoalesced;
+  DOUBLE dTotalDelay;
+  DOUBLE dMaxDelay;
+};
+
+// Deferred packets of each priority in the order they have been sent
+static CStaticStackArray<SQueuedPacket> _aQueuedPackets[CExtPacket::k_EPriority_Max];
+static SQueueStats _aQueueStats[CExtPacket::k_EPriority_Max];
+static INDEX _ctQueuedPackets = 0;
+
+// Get priority of packets of some type for clients
+CExtPacket::EPriority CExtPacket::GetPriority(ULONG ulType) {
+  switch (ulType) {
+    // Movement that doesn't break anything if it arrives a bit later
+    case k_EPacketType_EntityMove:
+    case k_EPacketType_EntityRotate:
+    case k_EPacketType_EntityImpulse:
+      return k_EPriority_Normal;
+
+    // Effects that don't change the game state
+    case k_EPacketType_PlaySound:
+      return k_EPriority_Cosmetic;
+  }
+
+  return k_EPriority_Critical;
+};
+
+// Get amount of bytes that can be sent to clients each tick (-1 if unlimited)
+static SLONG GetTickBandwidth(void) {
+  CServer &srv = _pNetwork->ga_srvServer;
+  SLONG slMinBPS = -1;
+
+  // Find the slowest client (server client doesn't go through the network)
+  for (INDEX i = 1; i < srv.srv_assoSessions.Count(); i++) {
+    CSessionSocket &sso = srv.srv_assoSessions[i];
+    if (!sso.IsActive()) continue;
+
+    const SLONG slBPS = sso.sso_sspParams.ssp_iMaxBPS;
+
+    if (slMinBPS == -1 || slBPS < slMinBPS) {
+      slMinBPS = slBPS;
+    }
+  }
+
+  if (slMinBPS == -1) return -1;
+
+  const FLOAT fShare = Clamp(ser_fExtQueueBandwidth, 0.01f, 1.0f);
+  return SLONG(slMinBPS * _pTimer->TickQuantum * fShare);
+};
+
+// Send deferred packets of some priority until there's no bandwidth left
+static void SendQueuedPackets(INDEX iPriority, SLONG &slBandwidth) {
+  CStaticStackArray<SQueuedPacket> &aQueue = _aQueuedPackets[iPriority];
+  SQueueStats &stats = _aQueueStats[iPriority];
+
+  const CTimerValue tvNow = _pTimer->GetHighPrecisionTimer();
+  const INDEX ct = aQueue.Count();
+  INDEX ctSent = 0;
+
+  for (; ctSent < ct; ctSent++) {
+    SQueuedPacket &qp = aQueue[ctSent];
+
+    const SLONG slSize = qp.pnmRecord->nm_slSize;
+    const DOUBLE dDelay = (tvNow - qp.tvQueued).GetSeconds();
+
+    // Keep the order and wait for more bandwidth, unless it's been waiting for too long
+    if (slBandwidth != -1 && slSize > slBandwidth && dDelay < ser_fExtQueueMaxDelay) break;
+
+    SendRecord(*qp.pnmRecord);
+
+    if (slBandwidth != -1) {
+      slBandwidth = ClampDn(slBandwidth - slSize, (SLONG)0);
+    }
+
+    stats.ctSent++;
+    stats.dTotalDelay += dDelay;
+    stats.dMaxDelay = Max(stats.dMaxDelay, dDelay);
+
+    delete qp.pnmRecord;
+    qp.pnmRecord = NULL;
+  }
+
+  if (ctSent == 0) return;
+
+  // Move the rest of the packets to the beginning
+  for (INDEX i = ctSent; i < ct; i++) {
+    aQueue[i - ctSent] = aQueue[i];
+  }
+
+  aQueue.PopUntil(ct - ctSent - 1);
+  _ctQueuedPackets -= ctSent;
+};
+
+// Send all deferred packets regardless of the bandwidth
+static void SendAllQueuedPackets(void) {
+  SLONG slUnlimited = -1;
+
+  for (INDEX i = 0; i < CExtPacket::k_EPriority_Max; i++) {
+    SendQueuedPackets(i, slUnlimited);
+  }
+};
+
+// Check if a packet of some type makes deferred packets refer to something that no longer exists
+static BOOL OutdatesQueuedPackets(ULONG ulType) {
+  switch (ulType) {
+    case k_EPacketType_EntityDelete:
+    case IClassicsExtPacket::k_EPacketType_ChangeLevel:
+    case IClassicsExtPacket::k_EPacketType_ChangeWorld:
+      return TRUE;
+  }
+
+  return FALSE;
+};
+
+// Check if a packet for clients can wait for bandwidth
+static BOOL CanDeferPacket(IClassicsExtPacket *pExtPacket) {
+  const ULONG ulType = pExtPacket->GetType();
+  if (CExtPacket::GetPriority(ulType) == CExtPacket::k_EPriority_Critical) return FALSE;
+
+  switch (ulType) {
+    // Entity ID 0 is the last entity created by the time the packet is processed, which
+    // would be a different one after packets for creating entities that are sent right away
+    case IClassicsExtPacket::k_EPacketType_EntityMove:
+    case IClassicsExtPacket::k_EPacketType_EntityRotate:
+    case IClassicsExtPacket::k_EPacketType_EntityImpulse:
+      return ((CExtEntityPacket *)pExtPacket)->GetEntityID() != 0;
+  }
+
+  return TRUE;
+};
+
+// Defer packet for clients until there's enough bandwidth for it
+void CExtPacket::AddToQueue(IClassicsExtPacket *pExtPacket) {
+  const ULONG ulType = pExtPacket->GetType();
+
+  CNetworkMessage nmRecord((MESSAGETYPE)INetwork::PCK_EXTENSION);
+
+  // Discard the packet
+  // Deferred packets may be sent after a client without the patch has joined, so they use the legacy format
+  if (!WriteRecord(pExtPacket, nmRecord, FALSE)) return;
+
+  const EPriority ePriority = GetPriority(ulType);
+  CStaticStackArray<SQueuedPacket> &aQueue = _aQueuedPackets[ePriority];
+
+  ULONG ulEntity = 0x7FFFFFFF;
+
+  // Movement packets only set new speed, so the newest one can replace the one for the same entity
+  if (ulType == k_EPacketType_EntityMove || ulType == k_EPacketType_EntityRotate) {
+    ulEntity = ((CExtEntityPacket *)pExtPacket)->GetEntityID();
+  }
+
+  // Last created entity (ID 0) may be a different entity for each packet
+  if (ulEntity != 0 && ulEntity < 0x7FFFFFFF) {
+    for (INDEX i = 0; i < aQueue.Count(); i++) {
+      SQueuedPacket &qp = aQueue[i];
+      if (qp.ulType != ulType || qp.ulEntity != ulEntity) continue;
+
+      // Keep the time of the older packet, so it's not deferred forever
+      delete qp.pnmRecord;
+      qp.pnmRecord = new CNetworkMessage(nmRecord);
+      qp.pnmRecord->Shrink();
+
+      _aQueueStats[ePriority].ctCoalesced++;
+      return;
+    }
+  }
+
+  // Make space by sending packets of the same priority in order
+  if (_ctQueuedPackets >= ClampDn(ser_iExtQueueMaxPackets, (INDEX)1)) {
+    SLONG slUnlimited = -1;
+    SendQueuedPackets(ePriority, slUnlimited);
+  }
+
+  SQueuedPacket &qp = aQueue.Push();
+  qp.pnmRecord = new CNetworkMessage(nmRecord);
+  qp.pnmRecord->Shrink();
+  qp.ulType = ulType;
+  qp.ulEntity = ulEntity;
+  qp.tvQueued = _pTimer->GetHighPrecisionTimer();
+
+  _ctQueuedPackets++;
+};
+
+// Send as many deferred packets to clients as the bandwidth allows this tick
+void CExtPacket::FlushQueue(void) {
+  SLONG slBandwidth = GetTickBandwidth();
+
+  // Packets sent right away during the last tick have used some of it up
+  if (slBandwidth != -1) {
+    slBandwidth = ClampDn(slBandwidth - _slSentThisTick, (SLONG)0);
+  }
+
+  // Packets of higher priorities go first
+  for (INDEX i = 0; i < k_EPriority_Max; i++) {
+    SendQueuedPackets(i, slBandwidth);
+  }
+
+  _slSentThisTick = 0;
+};
+
+// Discard all deferred packets
+void CExtPacket::ResetQueue(void) {
+  for (INDEX iPriority = 0; iPriority < k_EPriority_Max; iPriority++) {
+    CStaticStackArray<SQueuedPacket> &aQueue = _aQueuedPackets[iPriority];
+
+    for (INDEX i = 0; i < aQueue.Count(); i++) {
+      delete aQueue[i].pnmRecord;
+    }
+
+    aQueue.PopAll();
+  }
+
+  _ctQueuedPackets = 0;
+  _slSentThisTick = 0;
+};
+
+// Print delays of deferred packets of each priority
+void CExtPacket::PrintQueueStats(void) {
+  static const char *astrPriorities[k_EPriority_Max] = {
+    "Critical", "Normal", "Cosmetic",
+  };
+
+  CPrintF(TRANS("Deferred packets: %d (%d bytes per tick)\n"), _ctQueuedPackets, GetTickBandwidth());
+
+  // Critical packets are never deferred
+  for (INDEX i = k_EPriority_Normal; i < k_EPriority_Max; i++) {
+    const SQueueStats &stats = _aQueueStats[i];
+    const DOUBLE dAverage = (stats.ctSent != 0 ? stats.dTotalDelay / stats.ctSent : 0.0);
+
+    CPrintF(TRANS("  %-10s queued: %4d, sent: %6u, coalesced: %6u, delay: %7.1f ms average, %7.1f ms max\n"),
+      astrPriorities[i], _aQueuedPackets[i].Count(), stats.ctSent, stats.ctCoalesced, dAverage * 1000.0, stats.dMaxDelay * 1000.0);
+  }
+};
+
+// Reusable packet for receiving packets of one type
+struct SReceivedPacket {
+  CExtPacket *pPacket;
+  BOOL bInUse;
+};
+
+// Reusable packets by their slots
+static CStaticStackArray<SReceivedPacket> _aReceivedPackets;
+
+// Get slot index of a reusable packet of some type (-1 if the type cannot be received)
+static INDEX GetReceivedSlot(ULONG ulType) {
+  // Server to client packets go first
+  if (ulType <= IClassicsExtPacket::k_EPacketType_LastS2C) {
+    return ulType;
+  }
+
+  // Client to server packets go after them
+  if (ulType >= IClassicsExtPacket::k_EPacketType_FirstC2S) {
+    return IClassicsExtPacket::k_EPacketType_LastS2C + 1 + (ulType - IClassicsExtPacket::k_EPacketType_FirstC2S);
+  }
+
+  return -1;
+};
+
+// Acquire reusable packet of some type for receiving (NULL if there's no built-in packet of this type)
+CExtPacket *CExtPacket::AcquireReceived(EPacketType ePacket) {
+  const INDEX iSlot = GetReceivedSlot(ePacket);
+  if (iSlot == -1) return CreatePacket(ePacket);
+
+  // Reuse existing packet
+  if (iSlot < _aReceivedPackets.Count() && _aReceivedPackets[iSlot].pPacket != NULL) {
+    SReceivedPacket &rp = _aReceivedPackets[iSlot];
+
+    // Create a temporary packet if the reusable one is still being processed
+    if (rp.bInUse) return CreatePacket(ePacket);
+
+    // Every packet overwrites all of its fields upon reading, so there's no need to reset them
+    rp.bInUse = TRUE;
+    return rp.pPacket;
+  }
+
+  // Create the reusable packet once, if it's a valid type
+  CExtPacket *pPacket = CreatePacket(ePacket);
+  if (pPacket == NULL) return NULL;
+
+  // Add empty slots up to the needed one
+  while (_aReceivedPackets.Count() <= iSlot) {
+    SReceivedPacket &rpEmpty = _aReceivedPackets.Push();
+    rpEmpty.pPacket = NULL;
+    rpEmpty.bInUse = FALSE;
+  }
+
+  SReceivedPacket &rp = _aReceivedPackets[iSlot];
+  rp.pPacket = pPacket;
+  rp.bInUse = TRUE;
+  return pPacket;
+};
+
+// Give back the packet after receiving
+void CExtPacket::ReleaseReceived(CExtPacket *pPacket) {
+  const INDEX iSlot = GetReceivedSlot(pPacket->GetType());
+
+  // Keep the reusable packet for later
+  if (iSlot != -1 && iSlot < _aReceivedPackets.Count()) {
+    SReceivedPacket &rp = _aReceivedPackets[iSlot];
+
+    if (rp.pPacket == pPacket) {
+      ASSERT(rp.bInUse);
+      rp.bInUse = FALSE;
+      return;
+    }
+  }
+
+  // Discard the temporary packet
+  delete pPacket;
+};
+
 // [Cecil] TEMP: Get entity of a specific class under a certain index
 static INDEX GetEntity(SHELL_FUNC_ARGS) {
   BEGIN_SHELL_FUNC;
@@ -303,6 +1018,16 @@ static INDEX GetEntity(SHELL_FUNC_ARGS) {
 void CExtPacket::RegisterExtPackets(void)
 {
   _pShell->DeclareSymbol("persistent user INDEX ser_bReportExtPacketLogic;", &ser_bReportExtPacketLogic);
+  _pShell->DeclareSymbol("persistent user INDEX ser_iPlacementCoding;", &ser_iPlacementCoding);
+  _pShell->DeclareSymbol("persistent user INDEX ser_iPlacementPosBits;", &ser_iPlacementPosBits);
+  _pShell->DeclareSymbol("persistent user INDEX ser_iPlacementAngleBits;", &ser_iPlacementAngleBits);
+  _pShell->DeclareSymbol("persistent user INDEX ser_bBatchExtPackets;", &ser_bBatchExtPackets);
+  _pShell->DeclareSymbol("persistent user INDEX ser_iExtBatchSize;", &ser_iExtBatchSize);
+  _pShell->DeclareSymbol("persistent user INDEX ser_bQueueExtPackets;", &ser_bQueueExtPackets);
+  _pShell->DeclareSymbol("persistent user FLOAT ser_fExtQueueBandwidth;", &ser_fExtQueueBandwidth);
+  _pShell->DeclareSymbol("persistent user FLOAT ser_fExtQueueMaxDelay;", &ser_fExtQueueMaxDelay);
+  _pShell->DeclareSymbol("persistent user INDEX ser_iExtQueueMaxPackets;", &ser_iExtQueueMaxPackets);
+  _pShell->DeclareSymbol("user void ser_PrintExtQueueStats(void);", &CExtPacket::PrintQueueStats);
 
   // [Cecil] TEMP: Get entity of a specific class under a certain index
   _pShell->DeclareSymbol("user INDEX GetEntity(CTString, INDEX);", &GetEntity);
@@ -27,56 +27,219 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 // Report packet actions to the server
 CORE_API extern INDEX ser_bReportExtPacketLogic;
 
+// Default placement coding for entity placement packets (see EPlacementCoding)
+// Only used for packets in batches while all clients run the same patch version
+CORE_API extern INDEX ser_iPlacementCoding;
+
+// Fractional bits of quantized positions and rotation angles in entity placement packets
+CORE_API extern INDEX ser_iPlacementPosBits;
+CORE_API extern INDEX ser_iPlacementAngleBits;
+
+// Queue packets for clients during a tick and send them in one block, if all clients support it
+CORE_API extern INDEX ser_bBatchExtPackets;
+
+// Size of queued packets in bytes after which they are sent right away
+CORE_API extern INDEX ser_iExtBatchSize;
+
+// Defer packets of lower priorities until they fit into the bandwidth of the slowest client
+CORE_API extern INDEX ser_bQueueExtPackets;
+
+// Share of the slowest client's bandwidth that packets for clients can take up each tick
+CORE_API extern FLOAT ser_fExtQueueBandwidth;
+
+// Time in seconds after which deferred packets are sent regardless of the bandwidth
+CORE_API extern FLOAT ser_fExtQueueMaxDelay;
+
+// Maximum amount of deferred packets
+CORE_API extern INDEX ser_iExtQueueMaxPackets;
+
+// Maximum amount of fields in a built-in packet
+#define EXTPACKET_MAXFIELDS 16
+
+// Static field layout shared by all packets of the same type
+class CORE_API CExtPacketLayout {
+  public:
+    const char **astrNames; // Field names in the order of field indices
+    INDEX ctFields; // Amount of fields
+
+    // Open addressing table of field indices by name hashes (0xFF for empty slots)
+    UBYTE aubLookup[32];
+
+  public:
+    CExtPacketLayout(const char **astrSetNames, INDEX ctSetFields);
+
+    // Find field index by its name (-1 if it doesn't exist)
+    INDEX Find(const char *strName) const;
+};
+
+// Declare static field layout of a packet type
+#define EXTPACKET_DECLARELAYOUT \
+  static const CExtPacketLayout _layout; \
+  virtual const CExtPacketLayout &GetLayout(void) const { return _layout; }
+
+// Define static field layout of a packet type from an array of field names
+#define EXTPACKET_DEFINELAYOUT(_Class, _Names) \
+  const CExtPacketLayout _Class::_layout(_Names, ARRAYCOUNT(_Names))
+
 // Define built-in extension packets
 class CORE_API CExtPacket : public IClassicsBuiltInExtPacket {
+  public:
+    // Packet fields (each packet type continues from the fields of its base)
+    enum EField {
+      k_EField_Max = 0,
+    };
+
   protected:
     // Properties instead of raw data fields for easier modification via API
-    se1::map<CTString, CAnyValue> props;
+    // Indexed by packet fields and named by the packet layout
+    CAnyValue props[EXTPACKET_MAXFIELDS];
 
   public:
+    // Last coded vectors by entity IDs
+    typedef se1::map<ULONG, FLOAT3D> CBaselines;
+
+    // Priorities of packets for clients
+    enum EPriority {
+      k_EPriority_Critical = 0, // Sent right away
+      k_EPriority_Normal,       // Gameplay changes that can wait for bandwidth
+      k_EPriority_Cosmetic,     // Effects that are sent after everything else
+      k_EPriority_Max,
+    };
+
+    // Packets are being written or read in the format of this patch version instead of the legacy one
+    // It's only used for packets in batches, which aren't sent while any client runs a different version
+    static BOOL _bPatchFormat;
+
+  public:
+    // Get static field layout of this packet type
+    virtual const CExtPacketLayout &GetLayout(void) const = 0;
+
     // Convenient value getter
+    CAnyValue *GetValue(const char *strVariable);
     CAnyValue *GetValue(const CTString &strVariable);
 
     // Convenient value setter
+    bool operator()(const char *strVariable, const CAnyValue &val);
     bool operator()(const CTString &strVariable, const CAnyValue &val);
 
     // Create new packet from type
     static CExtPacket *CreatePacket(EPacketType ePacket);
 
+    // Acquire reusable packet of some type for receiving (NULL if there's no built-in packet of this type)
+    // The packet is owned by the core and must be given back via ReleaseReceived() after processing
+    // Plugins that need to keep a packet around should create their own via ClassicsPackets_Create()
+    static CExtPacket *AcquireReceived(EPacketType ePacket);
+
+    // Give back the packet after receiving
+    static void ReleaseReceived(CExtPacket *pPacket);
+
+    // Queue packet for clients to send it later in a batch
+    static void AddToBatch(IClassicsExtPacket *pExtPacket);
+
+    // Send all queued packets to clients (as one block, if all clients support it)
+    static void FlushBatch(void);
+
+    // Discard all queued packets
+    static void ResetBatch(void);
+
+    // Get priority of packets of some type for clients
+    static EPriority GetPriority(ULONG ulType);
+
+    // Defer packet for clients until there's enough bandwidth for it
+    static void AddToQueue(IClassicsExtPacket *pExtPacket);
+
+    // Send as many deferred packets to clients as the bandwidth allows this tick
+    static void FlushQueue(void);
+
+    // Discard all deferred packets
+    static void ResetQueue(void);
+
+    // Print delays of deferred packets of each priority
+    static void PrintQueueStats(void);
+
     // Register the module
     static void RegisterExtPackets(void);
+
+    // Write vector using some placement coding against a baseline from the map (if any)
+    // The map is updated with the value exactly as clients will decode it
+    // Without the patch format, the vector is written in the legacy format without any coding
+    void WriteCodedVector(CNetworkMessage &nm, const FLOAT3D &v, INDEX iCoding, BOOL bRotation, CBaselines *pmap, ULONG ulEntity);
+
+    // Read vector written using any placement coding against a baseline from the map (if any)
+    // Returns FALSE if it's a delta without a baseline, in which case the vector shouldn't be applied
+    BOOL ReadCodedVector(CNetworkMessage &nm, FLOAT3D &v, BOOL bRotation, CBaselines *pmap, ULONG ulEntity);
 };
 
 // Entity packets
 
 class CORE_API CExtEntityCreate : public CExtPacket {
+  public:
+    enum EField {
+      k_EField_fnmClass = CExtPacket::k_EField_Max,
+      k_EField_plPos,
+      k_EField_Max,
+    };
+
   public:
     static CEntity *penLast; // Last created entity
 
+    // Extra class files sent by the server since the last client has started joining (uppercase path -> ID)
+    static se1::map<CTString, INDEX> _mapSentClasses;
+
+    // Extra class files read from the game stream by their IDs
+    static CStaticStackArray<CTString> _astrReadClasses;
+
   public:
     CExtEntityCreate() {
-      props["fnmClass"] = ""; // Class file to create an entity from (packed as extra if index isn't found in the predefined list)
-      props["plPos"] = CPlacement3D(FLOAT3D(0, 0, 0), ANGLE3D(0, 0, 0)); // Place to create an entity at
+      props[k_EField_fnmClass] = ""; // Class file to create an entity from (packed as extra if index isn't found in the predefined list)
+      props[k_EField_plPos] = CPlacement3D(FLOAT3D(0, 0, 0), ANGLE3D(0, 0, 0)); // Place to create an entity at
     };
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_EntityCreate);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
     virtual void Process(void);
+
+    // Forget sent and/or read extra class files
+    static void ResetLearnedClasses(BOOL bSent, BOOL bRead);
 };
 
 // Base for entity manipulation packets
 class CORE_API CExtEntityPacket : public CExtPacket {
+  public:
+    enum EField {
+      k_EField_ulEntity = CExtPacket::k_EField_Max,
+      k_EField_Max,
+    };
+
+  public:
+    // Entity positions and rotations sent by the server since the last client has started joining
+    static CBaselines _mapSentPos;
+    static CBaselines _mapSentRot;
+
+    // Entity positions and rotations read from the game stream
+    static CBaselines _mapReadPos;
+    static CBaselines _mapReadRot;
+
   public:
     CExtEntityPacket() {
-      props["ulEntity"] = 0x7FFFFFFF; // Entity ID in the world (31 bits)
+      props[k_EField_ulEntity] = 0x7FFFFFFF; // Entity ID in the world (31 bits)
     };
 
+    EXTPACKET_DECLARELAYOUT;
+
+    // Forget sent and/or read baselines for delta coding
+    static void ResetBaselines(BOOL bSent, BOOL bRead);
+
+    // Get baselines for delta coding of an absolute vector of this entity (none if can't be used)
+    CBaselines *GetBaselines(BOOL bSent, BOOL bRotation);
+
     // Write entity ID
     void WriteEntity(CNetworkMessage &nm) {
-      ULONG ulEntity = ClampUp((ULONG)props["ulEntity"].GetIndex(), (ULONG)0x7FFFFFFFUL);
+      ULONG ulEntity = ClampUp((ULONG)props[k_EField_ulEntity].GetIndex(), (ULONG)0x7FFFFFFFUL);
       nm.WriteBits(&ulEntity, 31);
     };
 
@@ -84,13 +247,18 @@ class CORE_API CExtEntityPacket : public CExtPacket {
     void ReadEntity(CNetworkMessage &nm) {
       ULONG ulEntity = 0;
       nm.ReadBits(&ulEntity, 31);
-      props["ulEntity"].GetIndex() = ulEntity;
+      props[k_EField_ulEntity].GetIndex() = ulEntity;
+    };
+
+    // Get entity ID
+    inline ULONG GetEntityID(void) {
+      return props[k_EField_ulEntity].GetIndex();
     };
 
     // Check for invalid ID
     inline BOOL IsEntityValid(void) {
       // 0x7FFFFFFF - 0xFFFFFFFF are invalid
-      return ULONG(props["ulEntity"].GetIndex()) < 0x7FFFFFFF;
+      return ULONG(props[k_EField_ulEntity].GetIndex()) < 0x7FFFFFFF;
     };
 
     // Retrieve an entity from an ID
@@ -155,13 +323,20 @@ class CORE_API EExtEntityEvent : public CEntityEvent {
 };
 
 class CORE_API CExtEntityDelete : public CExtEntityPacket {
+  public:
+    enum EField {
+      k_EField_bSameClass = CExtEntityPacket::k_EField_Max,
+      k_EField_Max,
+    };
+
   public:
     CExtEntityDelete() : CExtEntityPacket() {
-      props["bSameClass"] = false; // Delete all instances of the same class
+      props[k_EField_bSameClass] = false; // Delete all instances of the same class
     };
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_EntityDelete);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
@@ -169,13 +344,20 @@ class CORE_API CExtEntityDelete : public CExtEntityPacket {
 };
 
 class CORE_API CExtEntityCopy : public CExtEntityPacket {
+  public:
+    enum EField {
+      k_EField_iCopies = CExtEntityPacket::k_EField_Max,
+      k_EField_Max,
+    };
+
   public:
     CExtEntityCopy() : CExtEntityPacket() {
-      props["iCopies"] = 1;
+      props[k_EField_iCopies] = 1;
     };
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_EntityCopy);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
@@ -236,14 +418,24 @@ class CORE_API CExtEntityInit : public CExtEntityEvent {
 };
 
 class CORE_API CExtEntityTeleport : public CExtEntityPacket {
+  public:
+    enum EField {
+      k_EField_plSet = CExtEntityPacket::k_EField_Max,
+      k_EField_bRelative,
+      k_EField_iCoding,
+      k_EField_Max,
+    };
+
   public:
     CExtEntityTeleport() : CExtEntityPacket() {
-      props["plSet"] = CPlacement3D(FLOAT3D(0, 0, 0), ANGLE3D(0, 0, 0)); // Placement to set
-      props["bRelative"] = false; // Relative to the current placement (oriented)
+      props[k_EField_plSet] = CPlacement3D(FLOAT3D(0, 0, 0), ANGLE3D(0, 0, 0)); // Placement to set
+      props[k_EField_bRelative] = false; // Relative to the current placement (oriented)
+      props[k_EField_iCoding] = ser_iPlacementCoding; // Placement coding (see EPlacementCoding)
     };
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_EntityTeleport);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
@@ -251,15 +443,26 @@ class CORE_API CExtEntityTeleport : public CExtEntityPacket {
 };
 
 class CORE_API CExtEntityPosition : public CExtEntityPacket {
+  public:
+    enum EField {
+      k_EField_vSet = CExtEntityPacket::k_EField_Max,
+      k_EField_bRotation,
+      k_EField_bRelative,
+      k_EField_iCoding,
+      k_EField_Max,
+    };
+
   public:
     CExtEntityPosition() : CExtEntityPacket() {
-      props["vSet"] = FLOAT3D(0, 0, 0); // Position or rotation to set
-      props["bRotation"] = false; // Set rotation instead of position
-      props["bRelative"] = false; // Relative to the current placement (axis-aligned)
+      props[k_EField_vSet] = FLOAT3D(0, 0, 0); // Position or rotation to set
+      props[k_EField_bRotation] = false; // Set rotation instead of position
+      props[k_EField_bRelative] = false; // Relative to the current placement (axis-aligned)
+      props[k_EField_iCoding] = ser_iPlacementCoding; // Placement coding (see EPlacementCoding)
     };
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_EntityPosition);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
@@ -267,13 +470,20 @@ class CORE_API CExtEntityPosition : public CExtEntityPacket {
 };
 
 class CORE_API CExtEntityParent : public CExtEntityPacket {
+  public:
+    enum EField {
+      k_EField_ulParent = CExtEntityPacket::k_EField_Max,
+      k_EField_Max,
+    };
+
   public:
     CExtEntityParent() : CExtEntityPacket() {
-      props["ulParent"] = -1;
+      props[k_EField_ulParent] = -1;
     };
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_EntityParent);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
@@ -281,37 +491,46 @@ class CORE_API CExtEntityParent : public CExtEntityPacket {
 };
 
 class CORE_API CExtEntityProp : public CExtEntityPacket {
+  public:
+    enum EField {
+      k_EField_bName = CExtEntityPacket::k_EField_Max,
+      k_EField_ulProp,
+      k_EField_value,
+      k_EField_Max,
+    };
+
   public:
     CExtEntityProp() : CExtEntityPacket() {
-      props["bName"] = false; // Using a name to find the property or not
-      props["ulProp"] = 0; // Property ID or name hash
-      props["value"] = 0.0; // DOUBLE or CTString
+      props[k_EField_bName] = false; // Using a name to find the property or not
+      props[k_EField_ulProp] = 0; // Property ID or name hash
+      props[k_EField_value] = 0.0; // DOUBLE or CTString
     };
 
     // Set property name
     inline void SetProperty(const CTString &strName) {
-      props["bName"].GetIndex() = true;
-      props["ulProp"].GetIndex() = strName.GetHash();
+      props[k_EField_bName].GetIndex() = true;
+      props[k_EField_ulProp].GetIndex() = strName.GetHash();
     };
 
     // Set property ID
     inline void SetProperty(ULONG ulID) {
-      props["bName"].GetIndex() = false;
-      props["ulProp"].GetIndex() = ulID;
+      props[k_EField_bName].GetIndex() = false;
+      props[k_EField_ulProp].GetIndex() = ulID;
     };
 
     // Set string value
     inline void SetValue(const CTString &str) {
-      props["value"] = str;
+      props[k_EField_value] = str;
     };
 
     // Set number value
     inline void SetValue(DOUBLE f) {
-      props["value"] = f;
+      props[k_EField_value] = f;
     };
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_EntityProp);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
@@ -319,13 +538,20 @@ class CORE_API CExtEntityProp : public CExtEntityPacket {
 };
 
 class CORE_API CExtEntityHealth : public CExtEntityPacket {
+  public:
+    enum EField {
+      k_EField_fHealth = CExtEntityPacket::k_EField_Max,
+      k_EField_Max,
+    };
+
   public:
     CExtEntityHealth() : CExtEntityPacket() {
-      props["fHealth"] = 0.0f; // Health to set
+      props[k_EField_fHealth] = 0.0f; // Health to set
     };
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_EntityHealth);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
@@ -333,36 +559,45 @@ class CORE_API CExtEntityHealth : public CExtEntityPacket {
 };
 
 class CORE_API CExtEntityFlags : public CExtEntityPacket {
+  public:
+    enum EField {
+      k_EField_ulFlags = CExtEntityPacket::k_EField_Max,
+      k_EField_iType,
+      k_EField_bRemove,
+      k_EField_Max,
+    };
+
   public:
     CExtEntityFlags() : CExtEntityPacket() {
-      props["ulFlags"] = 0; // Flags to apply
-      props["iType"] = 0; // Type of flags
-      props["bRemove"] = false; // Disable flags instead of enabling
+      props[k_EField_ulFlags] = 0; // Flags to apply
+      props[k_EField_iType] = 0; // Type of flags
+      props[k_EField_bRemove] = false; // Disable flags instead of enabling
     };
 
     // Set normal flags
     inline void EntityFlags(ULONG ul, BOOL bRemoveFlags) {
-      props["ulFlags"].GetIndex() = ul;
-      props["iType"].GetIndex() = 0;
-      props["bRemove"].GetIndex() = bRemoveFlags;
+      props[k_EField_ulFlags].GetIndex() = ul;
+      props[k_EField_iType].GetIndex() = 0;
+      props[k_EField_bRemove].GetIndex() = bRemoveFlags;
     };
 
     // Set physical flags
     inline void PhysicalFlags(ULONG ul, BOOL bRemoveFlags) {
-      props["ulFlags"].GetIndex() = ul;
-      props["iType"].GetIndex() = 1;
-      props["bRemove"].GetIndex() = bRemoveFlags;
+      props[k_EField_ulFlags].GetIndex() = ul;
+      props[k_EField_iType].GetIndex() = 1;
+      props[k_EField_bRemove].GetIndex() = bRemoveFlags;
     };
 
     // Set collision flags
     inline void CollisionFlags(ULONG ul, BOOL bRemoveFlags) {
-      props["ulFlags"].GetIndex() = ul;
-      props["iType"].GetIndex() = 2;
-      props["bRemove"].GetIndex() = bRemoveFlags;
+      props[k_EField_ulFlags].GetIndex() = ul;
+      props[k_EField_iType].GetIndex() = 2;
+      props[k_EField_bRemove].GetIndex() = bRemoveFlags;
     };
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_EntityFlags);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
@@ -370,13 +605,20 @@ class CORE_API CExtEntityFlags : public CExtEntityPacket {
 };
 
 class CORE_API CExtEntityMove : public CExtEntityPacket {
+  public:
+    enum EField {
+      k_EField_vSpeed = CExtEntityPacket::k_EField_Max,
+      k_EField_Max,
+    };
+
   public:
     CExtEntityMove() : CExtEntityPacket() {
-      props["vSpeed"] = FLOAT3D(0, 0, 0); // Desired speed
+      props[k_EField_vSpeed] = FLOAT3D(0, 0, 0); // Desired speed
     };
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_EntityMove);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
@@ -409,10 +651,17 @@ class CORE_API CExtEntityImpulse : public CExtEntityMove {
 
 // Abstract damage packet
 class CORE_API CExtEntityDamage : public CExtEntityPacket {
+  public:
+    enum EField {
+      k_EField_eDamageType = CExtEntityPacket::k_EField_Max,
+      k_EField_fDamage,
+      k_EField_Max,
+    };
+
   public:
     CExtEntityDamage() : CExtEntityPacket() {
-      props["eDamageType"] = (int)DMT_NONE; // Damage type to use
-      props["fDamage"] = 0.0f; // Damage to inflict
+      props[k_EField_eDamageType] = (int)DMT_NONE; // Damage type to use
+      props[k_EField_fDamage] = 0.0f; // Damage to inflict
     };
 
     virtual bool Write(CNetworkMessage &nm);
@@ -420,15 +669,24 @@ class CORE_API CExtEntityDamage : public CExtEntityPacket {
 };
 
 class CORE_API CExtEntityDirectDamage : public CExtEntityDamage {
+  public:
+    enum EField {
+      k_EField_ulTarget = CExtEntityDamage::k_EField_Max,
+      k_EField_vHitPoint,
+      k_EField_vDirection,
+      k_EField_Max,
+    };
+
   public:
     CExtEntityDirectDamage() : CExtEntityDamage() {
-      props["ulTarget"] = -1; // Target entity for damaging
-      props["vHitPoint"] = FLOAT3D(0, 0, 0); // Where exactly the damage occurred
-      props["vDirection"] = FLOAT3D(0, 0, 0); // From which direction the damage came from
+      props[k_EField_ulTarget] = -1; // Target entity for damaging
+      props[k_EField_vHitPoint] = FLOAT3D(0, 0, 0); // Where exactly the damage occurred
+      props[k_EField_vDirection] = FLOAT3D(0, 0, 0); // From which direction the damage came from
     };
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_EntityDirDmg);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
@@ -436,15 +694,24 @@ class CORE_API CExtEntityDirectDamage : public CExtEntityDamage {
 };
 
 class CORE_API CExtEntityRangeDamage : public CExtEntityDamage {
+  public:
+    enum EField {
+      k_EField_vCenter = CExtEntityDamage::k_EField_Max,
+      k_EField_fFallOff,
+      k_EField_fHotSpot,
+      k_EField_Max,
+    };
+
   public:
     CExtEntityRangeDamage() : CExtEntityDamage() {
-      props["vCenter"] = FLOAT3D(0, 0, 0); // Place to inflict damage from
-      props["fFallOff"] = 0.0f; // Total damage radius
-      props["fHotSpot"] = 0.0f; // Full damage radius
+      props[k_EField_vCenter] = FLOAT3D(0, 0, 0); // Place to inflict damage from
+      props[k_EField_fFallOff] = 0.0f; // Total damage radius
+      props[k_EField_fHotSpot] = 0.0f; // Full damage radius
     };
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_EntityRadDmg);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
@@ -452,13 +719,20 @@ class CORE_API CExtEntityRangeDamage : public CExtEntityDamage {
 };
 
 class CORE_API CExtEntityBoxDamage : public CExtEntityDamage {
+  public:
+    enum EField {
+      k_EField_boxArea = CExtEntityDamage::k_EField_Max,
+      k_EField_Max,
+    };
+
   public:
     CExtEntityBoxDamage() : CExtEntityDamage() {
-      props["boxArea"] = FLOATaabbox3D(FLOAT3D(0, 0, 0), 0.0f); // Area to inflict the damage in
+      props[k_EField_boxArea] = FLOATaabbox3D(FLOAT3D(0, 0, 0), 0.0f); // Area to inflict the damage in
     };
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_EntityBoxDmg);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
@@ -466,13 +740,20 @@ class CORE_API CExtEntityBoxDamage : public CExtEntityDamage {
 };
 
 class CORE_API CExtChangeLevel : public CExtPacket {
+  public:
+    enum EField {
+      k_EField_strWorld = CExtPacket::k_EField_Max,
+      k_EField_Max,
+    };
+
   public:
     CExtChangeLevel() {
-      props["strWorld"] = ""; // World file to change to
+      props[k_EField_strWorld] = ""; // World file to change to
     };
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_ChangeLevel);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
@@ -492,23 +773,31 @@ class CORE_API CExtChangeWorld : public CExtChangeLevel {
 };
 
 class CORE_API CExtSessionProps : public CExtPacket {
+  public:
+    enum EField {
+      k_EField_iSize = CExtPacket::k_EField_Max,
+      k_EField_iOffset,
+      k_EField_Max,
+    };
+
   public:
     CSesPropsContainer sp; // Session properties to set (data that's not processed isn't being zeroed!)
 
   public:
     CExtSessionProps() {
-      props["iSize"] = 0; // Amount of bytes to set
-      props["iOffset"] = 0; // Starting byte (up to NET_MAXSESSIONPROPERTIES - 1)
+      props[k_EField_iSize] = 0; // Amount of bytes to set
+      props[k_EField_iOffset] = 0; // Starting byte (up to NET_MAXSESSIONPROPERTIES - 1)
     };
 
-    inline INDEX &GetSize(void) { return props["iSize"].GetIndex(); };
-    inline INDEX &GetOffset(void) { return props["iOffset"].GetIndex(); };
+    inline INDEX &GetSize(void) { return props[k_EField_iSize].GetIndex(); };
+    inline INDEX &GetOffset(void) { return props[k_EField_iOffset].GetIndex(); };
 
     // Set new data at the current end and expand session properties size
     BOOL AddData(const void *pData, size_t ctBytes);
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_SessionProps);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
@@ -516,10 +805,17 @@ class CORE_API CExtSessionProps : public CExtPacket {
 };
 
 class CORE_API CExtGameplayExt : public CExtPacket {
+  public:
+    enum EField {
+      k_EField_iVar = CExtPacket::k_EField_Max,
+      k_EField_value,
+      k_EField_Max,
+    };
+
   public:
     CExtGameplayExt() {
-      props["iVar"] = 0; // Variable in the structure (0 is invalid, starts from 1)
-      props["value"] = 0.0; // DOUBLE or CTString
+      props[k_EField_iVar] = 0; // Variable in the structure (0 is invalid, starts from 1)
+      props[k_EField_value] = 0.0; // DOUBLE or CTString
     };
 
     // Find variable index by its name
@@ -533,6 +829,7 @@ class CORE_API CExtGameplayExt : public CExtPacket {
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_GameplayExt);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
@@ -540,24 +837,39 @@ class CORE_API CExtGameplayExt : public CExtPacket {
 };
 
 class CORE_API CExtPlaySound : public CExtPacket {
+  public:
+    enum EField {
+      k_EField_strFile = CExtPacket::k_EField_Max,
+      k_EField_iChannel,
+      k_EField_ulFlags,
+      k_EField_fDelay,
+      k_EField_fOffset,
+      k_EField_fVolumeL,
+      k_EField_fVolumeR,
+      k_EField_fFilterL,
+      k_EField_fFilterR,
+      k_EField_fPitch,
+      k_EField_Max,
+    };
+
   public:
     CExtPlaySound() {
       // Sound file to play
       // - Setting it to "/stop/" stops any playing sound on a specified channel
       // - Leaving it blank simply changes sound parameters of a channel without playing/resetting any sounds
-      props["strFile"] = "";
+      props[k_EField_strFile] = "";
 
-      props["iChannel"] = 0; // Playback channel (0-31)
-      props["ulFlags"] = SOF_NONE; // Playback flags
+      props[k_EField_iChannel] = 0; // Playback channel (0-31)
+      props[k_EField_ulFlags] = SOF_NONE; // Playback flags
 
       // Sound parameters
-      props["fDelay"] = 0.0f; // Playback delay (0.0+)
-      props["fOffset"] = 0.0f; // Playback offset in seconds
-      props["fVolumeL"] = 1.0f; // Left ear volume (0.0 .. 4.0)
-      props["fVolumeR"] = 1.0f; // Right ear volume (0.0 .. 4.0)
-      props["fFilterL"] = 1.0f; // Left ear filter (1.0 .. 500.0)
-      props["fFilterR"] = 1.0f; // Right ear filter (1.0 .. 500.0)
-      props["fPitch"] = 1.0f; // Playback pitch (0.0 .. 10.0)
+      props[k_EField_fDelay] = 0.0f; // Playback delay (0.0+)
+      props[k_EField_fOffset] = 0.0f; // Playback offset in seconds
+      props[k_EField_fVolumeL] = 1.0f; // Left ear volume (0.0 .. 4.0)
+      props[k_EField_fVolumeR] = 1.0f; // Right ear volume (0.0 .. 4.0)
+      props[k_EField_fFilterL] = 1.0f; // Left ear filter (1.0 .. 500.0)
+      props[k_EField_fFilterR] = 1.0f; // Right ear filter (1.0 .. 500.0)
+      props[k_EField_fPitch] = 1.0f; // Playback pitch (0.0 .. 10.0)
     };
 
     // Get channel from index
@@ -568,6 +880,7 @@ class CORE_API CExtPlaySound : public CExtPacket {
 
   public:
     EXTPACKET_DEFINEFORTYPE(k_EPacketType_PlaySound);
+    EXTPACKET_DECLARELAYOUT;
 
     virtual bool Write(CNetworkMessage &nm);
     virtual void Read(CNetworkMessage &nm);
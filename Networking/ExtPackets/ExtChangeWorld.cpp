@@ -22,7 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #if _PATCHCONFIG_EXT_PACKETS
 
 bool CExtChangeLevel::Write(CNetworkMessage &nm) {
-  CTString &strWorld = props["strWorld"].GetString();
+  CTString &strWorld = props[k_EField_strWorld].GetString();
 
   // Store up to 255 characters
   UBYTE ct = (UBYTE)ClampUp(strWorld.Length(), (INDEX)255);
@@ -37,7 +37,7 @@ bool CExtChangeLevel::Write(CNetworkMessage &nm) {
 };
 
 void CExtChangeLevel::Read(CNetworkMessage &nm) {
-  CTString &strWorld = props["strWorld"].GetString();
+  CTString &strWorld = props[k_EField_strWorld].GetString();
   strWorld = "";
 
   UBYTE ct;
@@ -52,7 +52,7 @@ void CExtChangeLevel::Read(CNetworkMessage &nm) {
 };
 
 void CExtChangeLevel::Process(void) {
-  const CTString &strWorld = props["strWorld"].GetString();
+  const CTString &strWorld = props[k_EField_strWorld].GetString();
 
   if (!FileExists(strWorld)) {
     ClassicsPackets_ServerReport(this, TRANS("Cannot change world to '%s': World file does not exist\n"), strWorld);
@@ -92,7 +92,7 @@ void CExtChangeLevel::Process(void) {
 };
 
 void CExtChangeWorld::Process(void) {
-  const CTString &strWorld = props["strWorld"].GetString();
+  const CTString &strWorld = props[k_EField_strWorld].GetString();
 
   if (!FileExists(strWorld)) {
     ClassicsPackets_ServerReport(this, TRANS("Cannot change world to '%s': World file does not exist\n"), strWorld);
@@ -22,7 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 bool CExtEntityCopy::Write(CNetworkMessage &nm) {
   WriteEntity(nm);
 
-  INDEX iCopies = props["iCopies"].GetIndex();
+  INDEX iCopies = props[k_EField_iCopies].GetIndex();
   nm.WriteBits(&iCopies, 5); // Up to 31
   return true;
 };
@@ -32,7 +32,7 @@ void CExtEntityCopy::Read(CNetworkMessage &nm) {
 
   INDEX iCopies = 0;
   nm.ReadBits(&iCopies, 5);
-  props["iCopies"].GetIndex() = iCopies;
+  props[k_EField_iCopies].GetIndex() = iCopies;
 };
 
 void CExtEntityCopy::Process(void) {
@@ -41,7 +41,7 @@ void CExtEntityCopy::Process(void) {
   if (!EntityExists(pen)) return;
 
   CTString strReport(0, TRANS("Copied %u entity: "), pen->en_ulID);
-  const INDEX iCopies = props["iCopies"].GetIndex();
+  const INDEX iCopies = props[k_EField_iCopies].GetIndex();
 
   for (INDEX i = 0; i < iCopies; i++) {
     // Update last created entity
@@ -16,6 +16,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "StdH.h"
 
 #include "Networking/ExtPackets.h"
+#include "Interfaces/HashFunctions.h"
 
 #if _PATCHCONFIG_EXT_PACKETS
 
@@ -182,10 +183,71 @@ static CTString _aBaseClasses[255] = {
 
 CEntity *CExtEntityCreate::penLast = NULL;
 
+// Extra class files sent by the server since the last client has started joining (uppercase path -> ID)
+se1::map<CTString, INDEX> CExtEntityCreate::_mapSentClasses;
+
+// Extra class files read from the game stream by their IDs
+CStaticStackArray<CTString> CExtEntityCreate::_astrReadClasses;
+
+// How many extra class files can be learned until the next reset
+static const INDEX _ctMaxLearnedClasses = 4096;
+
+// Hash table with indices of base classes (0xFF for empty slots)
+static UBYTE _aubBaseClassIndex[512];
+static BOOL _bBaseClassIndex = FALSE;
+
+// Find base class index by its name
+static UBYTE FindBaseClass(const char *strClass) {
+  const ULONG ulMask = ARRAYCOUNT(_aubBaseClassIndex) - 1;
+
+  // Fill the table once
+  if (!_bBaseClassIndex) {
+    _bBaseClassIndex = TRUE;
+    memset(_aubBaseClassIndex, 0xFF, sizeof(_aubBaseClassIndex));
+
+    for (INDEX i = 0; i < 0xFF; i++) {
+      // Empty base class
+      if (_aBaseClasses[i] == "") continue;
+
+      ULONG ulSlot = IHash::StringNoCase(_aBaseClasses[i]) & ulMask;
+
+      while (_aubBaseClassIndex[ulSlot] != 0xFF) {
+        ulSlot = (ulSlot + 1) & ulMask;
+      }
+
+      _aubBaseClassIndex[ulSlot] = (UBYTE)i;
+    }
+  }
+
+  ULONG ulSlot = IHash::StringNoCase(strClass) & ulMask;
+
+  for (; _aubBaseClassIndex[ulSlot] != 0xFF; ulSlot = (ulSlot + 1) & ulMask) {
+    const UBYTE ubClass = _aubBaseClassIndex[ulSlot];
+
+    // Compare filename with a base class regardless of case
+    if (stricmp(strClass, _aBaseClasses[ubClass]) == 0) {
+      return ubClass;
+    }
+  }
+
+  return 0xFF;
+};
+
+// Forget sent and/or read extra class files
+void CExtEntityCreate::ResetLearnedClasses(BOOL bSent, BOOL bRead) {
+  if (bSent) {
+    _mapSentClasses = se1::map<CTString, INDEX>();
+  }
+
+  if (bRead) {
+    _astrReadClasses.PopAll();
+  }
+};
+
 bool CExtEntityCreate::Write(CNetworkMessage &nm) {
   UBYTE ubClass = 0xFF; // Index in the dictionary (0-254; 255 is invalid)
 
-  const CTFileName fnmClass = props["fnmClass"].GetString();
+  const CTFileName fnmClass = props[k_EField_fnmClass].GetString();
   CTFileName fnmCheck = fnmClass;
 
   // If class file matches base classes
@@ -194,16 +256,7 @@ bool CExtEntityCreate::Write(CNetworkMessage &nm) {
       fnmCheck = fnmCheck.NoExt();
 
       // Find its index in the dictionary
-      for (UBYTE i = 0; i < 0xFF; i++) {
-        // Empty base class
-        if (_aBaseClasses[i] == "") continue;
-
-        // Compare filename with a base class regardless of case
-        if (stricmp(fnmCheck.str_String, _aBaseClasses[i]) == 0) {
-          ubClass = i;
-          break;
-        }
-      }
+      ubClass = FindBaseClass(fnmCheck.str_String);
     }
   }
 
@@ -213,15 +266,43 @@ bool CExtEntityCreate::Write(CNetworkMessage &nm) {
   if (ubClass == 0xFF) {
     const CTString strClassName = fnmClass.NoExt();
 
-    UBYTE ubLength = strClassName.Length();
-    nm << ubLength;
+    CTString strKey = strClassName;
+    strupr(strKey.str_String);
+
+    // Check if clients have already learned this class file (legacy format has no learned class files)
+    se1::map<CTString, INDEX>::const_iterator it = _mapSentClasses.find(strKey);
+    UBYTE ubLearned = (_bPatchFormat && it != _mapSentClasses.end());
+    if (_bPatchFormat) nm.WriteBits(&ubLearned, 1);
+
+    // Refer to the learned class file
+    if (ubLearned) {
+      INetCompress::Integer(nm, it->second);
+
+    } else {
+      UBYTE ubLength = strClassName.Length();
+      nm << ubLength;
+
+      for (UBYTE i = 0; i < ubLength; i++) {
+        INetCompress::PathChar(nm, strClassName[i]);
+      }
+
+      // Let clients learn it under the next ID
+      UBYTE ubLearn = (_bPatchFormat && (INDEX)_mapSentClasses.size() < _ctMaxLearnedClasses);
+      if (_bPatchFormat) nm.WriteBits(&ubLearn, 1);
 
-    for (UBYTE i = 0; i < ubLength; i++) {
-      INetCompress::PathChar(nm, strClassName[i]);
+      if (ubLearn) {
+        const INDEX iID = (INDEX)_mapSentClasses.size();
+        INetCompress::Integer(nm, iID);
+
+        _mapSentClasses[strKey] = iID;
+      }
     }
   }
 
-  INetCompress::Placement(nm, props["plPos"].GetPlacement());
+  // New entities have no baselines
+  const CPlacement3D &plPos = props[k_EField_plPos].GetPlacement();
+  WriteCodedVector(nm, plPos.pl_PositionVector, ser_iPlacementCoding, FALSE, NULL, 0);
+  WriteCodedVector(nm, plPos.pl_OrientationAngle, ser_iPlacementCoding, TRUE, NULL, 0);
   return true;
 };
 
@@ -231,29 +312,67 @@ void CExtEntityCreate::Read(CNetworkMessage &nm) {
 
   // Read extra class filename
   if (ubClass == 0xFF) {
-    UBYTE ubLength;
-    nm >> ubLength;
+    // Legacy format has no learned class files
+    UBYTE ubLearned = 0;
+    if (_bPatchFormat) nm.ReadBits(&ubLearned, 1);
 
-    // Read each character
-    char strAlloc[256]; // UBYTE maxes out at 255 anyway
-    INDEX iChar;
+    // Get class file learned earlier
+    if (ubLearned) {
+      ULONG ulID;
+      INetDecompress::Integer(nm, ulID);
 
-    for (iChar = 0; iChar < ubLength; iChar++) {
-      strAlloc[iChar] = INetDecompress::PathChar(nm);
-    }
+      if (ulID < (ULONG)_astrReadClasses.Count()) {
+        props[k_EField_fnmClass].GetString() = _astrReadClasses[ulID] + ".ecl";
 
-    // Set null-terminator at the end
-    strAlloc[iChar] = '\0';
+      } else {
+        CPrintF(TRANS("[%s] Received an unknown class file ID (%u)!\n"), GetName(), ulID);
+        props[k_EField_fnmClass].GetString() = "";
+      }
+
+    } else {
+      UBYTE ubLength;
+      nm >> ubLength;
 
-    // Assign path to the class
-    props["fnmClass"].GetString() = strAlloc + CTString(".ecl");
+      // Read each character
+      char strAlloc[256]; // UBYTE maxes out at 255 anyway
+      INDEX iChar;
+
+      for (iChar = 0; iChar < ubLength; iChar++) {
+        strAlloc[iChar] = INetDecompress::PathChar(nm);
+      }
+
+      // Set null-terminator at the end
+      strAlloc[iChar] = '\0';
+
+      // Assign path to the class
+      props[k_EField_fnmClass].GetString() = strAlloc + CTString(".ecl");
+
+      // Learn it under the given ID
+      UBYTE ubLearn = 0;
+      if (_bPatchFormat) nm.ReadBits(&ubLearn, 1);
+
+      if (ubLearn) {
+        ULONG ulID;
+        INetDecompress::Integer(nm, ulID);
+
+        if (ulID < (ULONG)_ctMaxLearnedClasses) {
+          while ((ULONG)_astrReadClasses.Count() <= ulID) {
+            _astrReadClasses.Push() = "";
+          }
+
+          _astrReadClasses[ulID] = strAlloc;
+        }
+      }
+    }
 
   // Get class from the dictionary
   } else {
-    props["fnmClass"].GetString() = "Classes\\" + _aBaseClasses[ubClass] + ".ecl";
+    props[k_EField_fnmClass].GetString() = "Classes\\" + _aBaseClasses[ubClass] + ".ecl";
   }
 
-  INetDecompress::Placement(nm, props["plPos"].GetPlacement());
+  CPlacement3D &plPos = props[k_EField_plPos].GetPlacement();
+  ReadCodedVector(nm, plPos.pl_PositionVector, FALSE, NULL, 0);
+  ReadCodedVector(nm, plPos.pl_OrientationAngle, TRUE, NULL, 0);
 };
 
 void CExtEntityCreate::Process(void) {
@@ -261,8 +380,14 @@ void CExtEntityCreate::Process(void) {
   penLast = NULL;
 
   try {
-    const CTString &fnmClass = props["fnmClass"].GetString();
-    const CPlacement3D &plPos = props["plPos"].GetPlacement();
+    const CTString &fnmClass = props[k_EField_fnmClass].GetString();
+    const CPlacement3D &plPos = props[k_EField_plPos].GetPlacement();
+
+    // Class file ID that hasn't been learned
+    if (fnmClass == "") {
+      ClassicsPackets_ServerReport(this, TRANS("Cannot create entity from an unknown class file!\n"));
+      return;
+    }
 
     penLast = IWorld::GetWorld()->CreateEntity_t(plPos, fnmClass);
     ClassicsPackets_ServerReport(this, TRANS("Created '%s' entity (%u)\n"), penLast->GetClass()->ec_pdecDLLClass->dec_strName, penLast->en_ulID);
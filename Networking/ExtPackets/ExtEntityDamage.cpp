@@ -22,11 +22,11 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 bool CExtEntityDamage::Write(CNetworkMessage &nm) {
   WriteEntity(nm);
 
-  ULONG ulDamageType = props["eDamageType"].GetIndex();
+  ULONG ulDamageType = props[k_EField_eDamageType].GetIndex();
   INetCompress::Integer(nm, ulDamageType);
 
   // Write damage amount up to 2 decimal places
-  ULONG ulDamagePoints = ULONG(props["fDamage"].GetFloat()) * 100;
+  ULONG ulDamagePoints = ULONG(props[k_EField_fDamage].GetFloat()) * 100;
   INetCompress::Integer(nm, ulDamagePoints);
   return true;
 };
@@ -41,16 +41,16 @@ void CExtEntityDamage::Read(CNetworkMessage &nm) {
   ULONG ulDamagePoints;
   INetDecompress::Integer(nm, ulDamagePoints);
 
-  props["eDamageType"].GetIndex() = ulDamageType;
-  props["fDamage"].GetFloat() = FLOAT(ulDamagePoints) * 0.01f;
+  props[k_EField_eDamageType].GetIndex() = ulDamageType;
+  props[k_EField_fDamage].GetFloat() = FLOAT(ulDamagePoints) * 0.01f;
 };
 
 bool CExtEntityDirectDamage::Write(CNetworkMessage &nm) {
   CExtEntityDamage::Write(nm);
 
-  INetCompress::Integer(nm, props["ulTarget"].GetIndex());
-  INetCompress::Float3D(nm, props["vHitPoint"].GetVector());
-  INetCompress::Float3D(nm, props["vDirection"].GetVector());
+  INetCompress::Integer(nm, props[k_EField_ulTarget].GetIndex());
+  INetCompress::Float3D(nm, props[k_EField_vHitPoint].GetVector());
+  INetCompress::Float3D(nm, props[k_EField_vDirection].GetVector());
   return true;
 };
 
@@ -59,10 +59,10 @@ void CExtEntityDirectDamage::Read(CNetworkMessage &nm) {
 
   ULONG ulTarget;
   INetDecompress::Integer(nm, ulTarget);
-  props["ulTarget"].GetIndex() = ulTarget;
+  props[k_EField_ulTarget].GetIndex() = ulTarget;
 
-  INetDecompress::Float3D(nm, props["vHitPoint"].GetVector());
-  INetDecompress::Float3D(nm, props["vDirection"].GetVector());
+  INetDecompress::Float3D(nm, props[k_EField_vHitPoint].GetVector());
+  INetDecompress::Float3D(nm, props[k_EField_vDirection].GetVector());
 };
 
 void CExtEntityDirectDamage::Process(void) {
@@ -70,15 +70,15 @@ void CExtEntityDirectDamage::Process(void) {
 
   if (!EntityExists(pen)) return;
 
-  const ULONG ulTarget = props["ulTarget"].GetIndex();
+  const ULONG ulTarget = props[k_EField_ulTarget].GetIndex();
   CEntity *penTarget = FindExtEntity(ulTarget);
 
   if (penTarget == NULL) return;
 
-  const DamageType eDamageType = (DamageType)props["eDamageType"].GetIndex();
-  const FLOAT fDamage = props["fDamage"].GetFloat();
-  const FLOAT3D vHitPoint = props["vHitPoint"].GetVector();
-  const FLOAT3D vDirection = props["vDirection"].GetVector();
+  const DamageType eDamageType = (DamageType)props[k_EField_eDamageType].GetIndex();
+  const FLOAT fDamage = props[k_EField_fDamage].GetFloat();
+  const FLOAT3D vHitPoint = props[k_EField_vHitPoint].GetVector();
+  const FLOAT3D vDirection = props[k_EField_vDirection].GetVector();
 
   pen->InflictDirectDamage(penTarget, pen, eDamageType, fDamage, vHitPoint, vDirection);
 
@@ -88,12 +88,12 @@ void CExtEntityDirectDamage::Process(void) {
 bool CExtEntityRangeDamage::Write(CNetworkMessage &nm) {
   CExtEntityDamage::Write(nm);
 
-  INetCompress::Float3D(nm, props["vCenter"].GetVector());
+  INetCompress::Float3D(nm, props[k_EField_vCenter].GetVector());
 
-  ULONG ulRange = ULONG(props["fFallOff"].GetFloat()) * 10;
+  ULONG ulRange = ULONG(props[k_EField_fFallOff].GetFloat()) * 10;
   INetCompress::Integer(nm, ulRange);
 
-  ulRange = ULONG(props["fHotSpot"].GetFloat()) * 10;
+  ulRange = ULONG(props[k_EField_fHotSpot].GetFloat()) * 10;
   INetCompress::Integer(nm, ulRange);
   return true;
 };
@@ -101,14 +101,14 @@ bool CExtEntityRangeDamage::Write(CNetworkMessage &nm) {
 void CExtEntityRangeDamage::Read(CNetworkMessage &nm) {
   CExtEntityDamage::Read(nm);
 
-  INetDecompress::Float3D(nm, props["vCenter"].GetVector());
+  INetDecompress::Float3D(nm, props[k_EField_vCenter].GetVector());
 
   ULONG ulRange;
   INetDecompress::Integer(nm, ulRange);
-  props["fFallOff"].GetFloat() = FLOAT(ulRange) / 10.0f;
+  props[k_EField_fFallOff].GetFloat() = FLOAT(ulRange) / 10.0f;
 
   INetDecompress::Integer(nm, ulRange);
-  props["fHotSpot"].GetFloat() = FLOAT(ulRange) / 10.0f;
+  props[k_EField_fHotSpot].GetFloat() = FLOAT(ulRange) / 10.0f;
 };
 
 void CExtEntityRangeDamage::Process(void) {
@@ -116,11 +116,11 @@ void CExtEntityRangeDamage::Process(void) {
 
   if (!EntityExists(pen)) return;
 
-  const DamageType eDamageType = (DamageType)props["eDamageType"].GetIndex();
-  const FLOAT fDamage = props["fDamage"].GetFloat();
-  const FLOAT3D vCenter = props["vCenter"].GetVector();
-  const FLOAT fFallOff = props["fFallOff"].GetFloat();
-  const FLOAT fHotSpot = props["fHotSpot"].GetFloat();
+  const DamageType eDamageType = (DamageType)props[k_EField_eDamageType].GetIndex();
+  const FLOAT fDamage = props[k_EField_fDamage].GetFloat();
+  const FLOAT3D vCenter = props[k_EField_vCenter].GetVector();
+  const FLOAT fFallOff = props[k_EField_fFallOff].GetFloat();
+  const FLOAT fHotSpot = props[k_EField_fHotSpot].GetFloat();
 
   pen->InflictRangeDamage(pen, eDamageType, fDamage, vCenter, fHotSpot, fFallOff);
 
@@ -130,7 +130,7 @@ void CExtEntityRangeDamage::Process(void) {
 bool CExtEntityBoxDamage::Write(CNetworkMessage &nm) {
   CExtEntityDamage::Write(nm);
 
-  const FLOATaabbox3D &boxArea = props["boxArea"].GetBox();
+  const FLOATaabbox3D &boxArea = props[k_EField_boxArea].GetBox();
   INetCompress::Float3D(nm, boxArea.minvect);
   INetCompress::Float3D(nm, boxArea.maxvect);
   return true;
@@ -139,7 +139,7 @@ bool CExtEntityBoxDamage::Write(CNetworkMessage &nm) {
 void CExtEntityBoxDamage::Read(CNetworkMessage &nm) {
   CExtEntityDamage::Read(nm);
 
-  FLOATaabbox3D &boxArea = props["boxArea"].GetBox();
+  FLOATaabbox3D &boxArea = props[k_EField_boxArea].GetBox();
   INetDecompress::Float3D(nm, boxArea.minvect);
   INetDecompress::Float3D(nm, boxArea.maxvect);
 };
@@ -149,9 +149,9 @@ void CExtEntityBoxDamage::Process(void) {
 
   if (!EntityExists(pen)) return;
 
-  const DamageType eDamageType = (DamageType)props["eDamageType"].GetIndex();
-  const FLOAT fDamage = props["fDamage"].GetFloat();
-  const FLOATaabbox3D &boxArea = props["boxArea"].GetBox();
+  const DamageType eDamageType = (DamageType)props[k_EField_eDamageType].GetIndex();
+  const FLOAT fDamage = props[k_EField_fDamage].GetFloat();
+  const FLOATaabbox3D &boxArea = props[k_EField_boxArea].GetBox();
 
   pen->InflictBoxDamage(pen, eDamageType, fDamage, boxArea);
 
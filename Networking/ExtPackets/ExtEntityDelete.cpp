@@ -22,7 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 bool CExtEntityDelete::Write(CNetworkMessage &nm) {
   WriteEntity(nm);
 
-  BOOL bSameClass = props["bSameClass"].IsTrue();
+  BOOL bSameClass = props[k_EField_bSameClass].IsTrue();
   nm.WriteBits(&bSameClass, 1);
   return true;
 };
@@ -32,7 +32,7 @@ void CExtEntityDelete::Read(CNetworkMessage &nm) {
 
   BOOL bSameClass = FALSE;
   nm.ReadBits(&bSameClass, 1);
-  props["bSameClass"].GetIndex() = bSameClass;
+  props[k_EField_bSameClass].GetIndex() = bSameClass;
 };
 
 void CExtEntityDelete::Process(void) {
@@ -46,7 +46,7 @@ void CExtEntityDelete::Process(void) {
   }
 
   // Delete all entities of the same class
-  if (props["bSameClass"].IsTrue()) {
+  if (props[k_EField_bSameClass].IsTrue()) {
     const char *strClass = pen->GetClass()->ec_pdecDLLClass->dec_strName;
     INDEX iClassID = pen->GetClass()->ec_pdecDLLClass->dec_iID;
 
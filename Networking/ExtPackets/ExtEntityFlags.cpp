@@ -22,13 +22,13 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 bool CExtEntityFlags::Write(CNetworkMessage &nm) {
   WriteEntity(nm);
 
-  ULONG ulFlags = props["ulFlags"].GetIndex();
+  ULONG ulFlags = props[k_EField_ulFlags].GetIndex();
   INetCompress::Integer(nm, ulFlags);
 
-  INDEX iType = props["iType"].GetIndex();
+  INDEX iType = props[k_EField_iType].GetIndex();
   nm.WriteBits(&iType, 2);
 
-  BOOL bRemove = props["bRemove"].IsTrue();
+  BOOL bRemove = props[k_EField_bRemove].IsTrue();
   nm.WriteBits(&bRemove, 1);
   return true;
 };
@@ -38,15 +38,15 @@ void CExtEntityFlags::Read(CNetworkMessage &nm) {
 
   ULONG ulFlags;
   INetDecompress::Integer(nm, ulFlags);
-  props["ulFlags"].GetIndex() = ulFlags;
+  props[k_EField_ulFlags].GetIndex() = ulFlags;
 
   INDEX iType = 0;
   nm.ReadBits(&iType, 2);
-  props["iType"].GetIndex() = iType;
+  props[k_EField_iType].GetIndex() = iType;
 
   BOOL bRemove = FALSE;
   nm.ReadBits(&bRemove, 1);
-  props["bRemove"].GetIndex() = bRemove;
+  props[k_EField_bRemove].GetIndex() = bRemove;
 };
 
 void CExtEntityFlags::Process(void) {
@@ -54,9 +54,9 @@ void CExtEntityFlags::Process(void) {
 
   if (!EntityExists(pen)) return;
 
-  const ULONG ulFlags = props["ulFlags"].GetIndex();
-  const INDEX iType = props["iType"].GetIndex();
-  const BOOL bRemove = props["bRemove"].IsTrue();
+  const ULONG ulFlags = props[k_EField_ulFlags].GetIndex();
+  const INDEX iType = props[k_EField_iType].GetIndex();
+  const BOOL bRemove = props[k_EField_bRemove].IsTrue();
 
   ULONG *pulFlags = &pen->en_ulFlags;
   CTString strReport = TRANS("Changed flags of %u entity: 0x%08X -> 0x%08X\n");
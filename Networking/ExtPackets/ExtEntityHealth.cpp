@@ -21,13 +21,13 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 bool CExtEntityHealth::Write(CNetworkMessage &nm) {
   WriteEntity(nm);
-  INetCompress::Float(nm, props["fHealth"].GetFloat());
+  INetCompress::Float(nm, props[k_EField_fHealth].GetFloat());
   return true;
 };
 
 void CExtEntityHealth::Read(CNetworkMessage &nm) {
   ReadEntity(nm);
-  INetDecompress::Float(nm, props["fHealth"].GetFloat());
+  INetDecompress::Float(nm, props[k_EField_fHealth].GetFloat());
 };
 
 void CExtEntityHealth::Process(void) {
@@ -36,7 +36,7 @@ void CExtEntityHealth::Process(void) {
   if (!EntityExists(pen)) return;
 
   if (IsLiveEntity(pen)) {
-    FLOAT fHealth = props["fHealth"].GetFloat();
+    FLOAT fHealth = props[k_EField_fHealth].GetFloat();
 
     ((CLiveEntity *)pen)->SetHealth(fHealth);
     ClassicsPackets_ServerReport(this, TRANS("Set health of %u entity to %.2f\n"), pen->en_ulID, fHealth);
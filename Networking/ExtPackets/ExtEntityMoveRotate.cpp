@@ -21,13 +21,13 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 bool CExtEntityMove::Write(CNetworkMessage &nm) {
   WriteEntity(nm);
-  INetCompress::Float3D(nm, props["vSpeed"].GetVector());
+  INetCompress::Float3D(nm, props[k_EField_vSpeed].GetVector());
   return true;
 };
 
 void CExtEntityMove::Read(CNetworkMessage &nm) {
   ReadEntity(nm);
-  INetDecompress::Float3D(nm, props["vSpeed"].GetVector());
+  INetDecompress::Float3D(nm, props[k_EField_vSpeed].GetVector());
 };
 
 #define REPORT_NOT_MOVABLE TRANS("not a movable entity")
@@ -38,7 +38,7 @@ void CExtEntityMove::Process(void) {
   if (!EntityExists(pen)) return;
 
   if (IsDerivedFromID(pen, CMovableEntity_ClassID)) {
-    CAnyValue &val = props["vSpeed"];
+    CAnyValue &val = props[k_EField_vSpeed];
 
     ((CMovableEntity *)pen)->SetDesiredTranslation(val.GetVector());
     ClassicsPackets_ServerReport(this, TRANS("Changed movement speed of %u entity to %s\n"), pen->en_ulID, val.ToString());
@@ -54,7 +54,7 @@ void CExtEntityRotate::Process(void) {
   if (!EntityExists(pen)) return;
 
   if (IsDerivedFromID(pen, CMovableEntity_ClassID)) {
-    CAnyValue &val = props["vSpeed"];
+    CAnyValue &val = props[k_EField_vSpeed];
 
     ((CMovableEntity *)pen)->SetDesiredRotation(val.GetVector());
     ClassicsPackets_ServerReport(this, TRANS("Changed rotation speed of %u entity to %s\n"), pen->en_ulID, val.ToString());
@@ -70,7 +70,7 @@ void CExtEntityImpulse::Process(void) {
   if (!EntityExists(pen)) return;
 
   if (IsDerivedFromID(pen, CMovableEntity_ClassID)) {
-    CAnyValue &val = props["vSpeed"];
+    CAnyValue &val = props[k_EField_vSpeed];
 
     ((CMovableEntity *)pen)->GiveImpulseTranslationAbsolute(val.GetVector());
     ClassicsPackets_ServerReport(this, TRANS("Gave impulse to %u entity: %s\n"), pen->en_ulID, val.ToString());
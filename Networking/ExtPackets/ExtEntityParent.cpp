@@ -22,7 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 bool CExtEntityParent::Write(CNetworkMessage &nm) {
   WriteEntity(nm);
 
-  ULONG ulParent = props["ulParent"].GetIndex();
+  ULONG ulParent = props[k_EField_ulParent].GetIndex();
   INetCompress::Integer(nm, ulParent);
   return true;
 };
@@ -32,7 +32,7 @@ void CExtEntityParent::Read(CNetworkMessage &nm) {
 
   ULONG ulParent;
   INetDecompress::Integer(nm, ulParent);
-  props["ulParent"].GetIndex() = ulParent;
+  props[k_EField_ulParent].GetIndex() = ulParent;
 };
 
 void CExtEntityParent::Process(void) {
@@ -40,7 +40,7 @@ void CExtEntityParent::Process(void) {
 
   if (!EntityExists(pen)) return;
 
-  const ULONG ulParent = props["ulParent"].GetIndex();
+  const ULONG ulParent = props[k_EField_ulParent].GetIndex();
   CEntity *penParent = FindExtEntity(ulParent);
 
   pen->SetParent(penParent);
@@ -22,19 +22,20 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 bool CExtEntityPosition::Write(CNetworkMessage &nm) {
   WriteEntity(nm);
 
-  BOOL bRotation = props["bRotation"].IsTrue();
+  BOOL bRotation = props[k_EField_bRotation].IsTrue();
   nm.WriteBits(&bRotation, 1);
 
-  const FLOAT3D &vSet = props["vSet"].GetVector();
+  // Legacy format has the relative flag after the values
+  BOOL bRelative = props[k_EField_bRelative].IsTrue();
+  if (_bPatchFormat) nm.WriteBits(&bRelative, 1);
 
-  if (bRotation) {
-    INetCompress::Angle3D(nm, vSet);
-  } else {
-    INetCompress::Float3D(nm, vSet);
-  }
+  // Only absolute values can be coded against the last sent ones
+  CBaselines *pmap = (bRelative ? NULL : GetBaselines(TRUE, bRotation));
+
+  const FLOAT3D &vSet = props[k_EField_vSet].GetVector();
+  WriteCodedVector(nm, vSet, props[k_EField_iCoding].GetIndex(), bRotation, pmap, props[k_EField_ulEntity].GetIndex());
 
-  BOOL bRelative = props["bRelative"].IsTrue();
-  nm.WriteBits(&bRelative, 1);
+  if (!_bPatchFormat) nm.WriteBits(&bRelative, 1);
   return true;
 };
 
@@ -43,19 +44,24 @@ void CExtEntityPosition::Read(CNetworkMessage &nm) {
 
   BOOL bRotation = FALSE;
   nm.ReadBits(&bRotation, 1);
-  props["bRotation"].GetIndex() = bRotation;
+  props[k_EField_bRotation].GetIndex() = bRotation;
 
-  FLOAT3D &vSet = props["vSet"].GetVector();
+  // Legacy format has the relative flag after the values
+  BOOL bRelative = FALSE;
+  if (_bPatchFormat) nm.ReadBits(&bRelative, 1);
 
-  if (bRotation) {
-    INetDecompress::Angle3D(nm, vSet);
-  } else {
-    INetDecompress::Float3D(nm, vSet);
-  }
+  CBaselines *pmap = (bRelative ? NULL : GetBaselines(FALSE, bRotation));
 
-  BOOL bRelative = FALSE;
-  nm.ReadBits(&bRelative, 1);
-  props["bRelative"].GetIndex() = bRelative;
+  FLOAT3D &vSet = props[k_EField_vSet].GetVector();
+  const BOOL bDecoded = ReadCodedVector(nm, vSet, bRotation, pmap, props[k_EField_ulEntity].GetIndex());
+
+  if (!_bPatchFormat) nm.ReadBits(&bRelative, 1);
+  props[k_EField_bRelative].GetIndex() = bRelative;
+
+  // Don't apply a value that couldn't be decoded
+  if (!bDecoded) {
+    props[k_EField_ulEntity].GetIndex() = 0x7FFFFFFF;
+  }
 };
 
 void CExtEntityPosition::Process(void) {
@@ -65,9 +71,9 @@ void CExtEntityPosition::Process(void) {
 
   CPlacement3D pl = pen->GetPlacement();
 
-  const FLOAT3D &vSet = props["vSet"].GetVector();
-  const BOOL bRotation = props["bRotation"].IsTrue();
-  const BOOL bRelative = props["bRelative"].IsTrue();
+  const FLOAT3D &vSet = props[k_EField_vSet].GetVector();
+  const BOOL bRotation = props[k_EField_bRotation].IsTrue();
+  const BOOL bRelative = props[k_EField_bRelative].IsTrue();
 
   // Relative to absolute axes
   if (bRelative) {
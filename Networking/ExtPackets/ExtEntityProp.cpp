@@ -22,17 +22,17 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 bool CExtEntityProp::Write(CNetworkMessage &nm) {
   WriteEntity(nm);
 
-  BOOL bName = props["bName"].IsTrue();
+  BOOL bName = props[k_EField_bName].IsTrue();
   nm.WriteBits(&bName, 1);
-  nm << (ULONG)props["ulProp"].GetIndex();
+  nm << (ULONG)props[k_EField_ulProp].GetIndex();
 
-  BOOL bString = (props["value"].GetType() == CAnyValue::E_VAL_STRING);
+  BOOL bString = (props[k_EField_value].GetType() == CAnyValue::E_VAL_STRING);
   nm.WriteBits(&bString, 1);
 
   if (bString) {
-    nm << props["value"].ToString();
+    nm << props[k_EField_value].ToString();
   } else {
-    INetCompress::Double(nm, props["value"].ToFloat());
+    INetCompress::Double(nm, props[k_EField_value].ToFloat());
   }
 
   return true;
@@ -43,11 +43,11 @@ void CExtEntityProp::Read(CNetworkMessage &nm) {
 
   BOOL bName = FALSE;
   nm.ReadBits(&bName, 1);
-  props["bName"].GetIndex() = bName;
+  props[k_EField_bName].GetIndex() = bName;
 
   ULONG ulProp;
   nm >> ulProp;
-  props["ulProp"].GetIndex() = ulProp;
+  props[k_EField_ulProp].GetIndex() = ulProp;
 
   BOOL bString = FALSE;
   nm.ReadBits(&bString, 1);
@@ -55,12 +55,12 @@ void CExtEntityProp::Read(CNetworkMessage &nm) {
   if (bString) {
     CTString strValue;
     nm >> strValue;
-    props["value"] = strValue;
+    props[k_EField_value] = strValue;
 
   } else {
     DOUBLE fValue;
     INetDecompress::Double(nm, fValue);
-    props["value"] = fValue;
+    props[k_EField_value] = fValue;
   }
 };
 
@@ -70,9 +70,9 @@ void CExtEntityProp::Process(void) {
   if (!EntityExists(pen)) return;
 
   CEntityProperty *pep = NULL;
-  ULONG ulProp = props["ulProp"].GetIndex();
+  ULONG ulProp = props[k_EField_ulProp].GetIndex();
 
-  if (props["bName"].IsTrue()) {
+  if (props[k_EField_bName].IsTrue()) {
     pep = IWorld::PropertyForHash(pen, ulProp);
   } else {
     pep = IWorld::PropertyForId(pen, ulProp);
@@ -82,22 +82,22 @@ void CExtEntityProp::Process(void) {
 
   INDEX iType = IProperties::ConvertType(pep->ep_eptType);
 
-  bool bString = (props["value"].GetType() == CAnyValue::E_VAL_STRING);
+  bool bString = (props[k_EField_value].GetType() == CAnyValue::E_VAL_STRING);
 
   if (bString) {
     if (iType == CEntityProperty::EPT_STRING) {
-      CTString &strValue = props["value"].GetString();
+      CTString &strValue = props[k_EField_value].GetString();
       IProperties::SetPropValue(pen, pep, &strValue);
     } else {
       ClassicsPackets_ServerReport(this, TRANS("Expected string property type but got %d\n"), iType);
     }
 
   } else if (iType == CEntityProperty::EPT_FLOAT) {
-    FLOAT fFloatProp = props["value"].ToFloat();
+    FLOAT fFloatProp = props[k_EField_value].ToFloat();
     IProperties::SetPropValue(pen, pep, &fFloatProp);
 
   } else if (iType == CEntityProperty::EPT_INDEX) {
-    INDEX iIntProp = props["value"].ToIndex();
+    INDEX iIntProp = props[k_EField_value].ToIndex();
     IProperties::SetPropValue(pen, pep, &iIntProp);
 
   } else {
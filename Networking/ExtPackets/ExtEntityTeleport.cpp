@@ -21,20 +21,43 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 bool CExtEntityTeleport::Write(CNetworkMessage &nm) {
   WriteEntity(nm);
-  INetCompress::Placement(nm, props["plSet"].GetPlacement());
 
-  BOOL bRelative = props["bRelative"].IsTrue();
-  nm.WriteBits(&bRelative, 1);
+  // Legacy format has the relative flag after the placement
+  BOOL bRelative = props[k_EField_bRelative].IsTrue();
+  if (_bPatchFormat) nm.WriteBits(&bRelative, 1);
+
+  const CPlacement3D &plSet = props[k_EField_plSet].GetPlacement();
+  const INDEX iCoding = props[k_EField_iCoding].GetIndex();
+  const ULONG ulEntity = props[k_EField_ulEntity].GetIndex();
+
+  // Only absolute placements can be coded against the last sent ones
+  WriteCodedVector(nm, plSet.pl_PositionVector, iCoding, FALSE, (bRelative ? NULL : GetBaselines(TRUE, FALSE)), ulEntity);
+  WriteCodedVector(nm, plSet.pl_OrientationAngle, iCoding, TRUE, (bRelative ? NULL : GetBaselines(TRUE, TRUE)), ulEntity);
+
+  if (!_bPatchFormat) nm.WriteBits(&bRelative, 1);
   return true;
 };
 
 void CExtEntityTeleport::Read(CNetworkMessage &nm) {
   ReadEntity(nm);
-  INetDecompress::Placement(nm, props["plSet"].GetPlacement());
 
+  // Legacy format has the relative flag after the placement
   BOOL bRelative = FALSE;
-  nm.ReadBits(&bRelative, 1);
-  props["bRelative"].GetIndex() = bRelative;
+  if (_bPatchFormat) nm.ReadBits(&bRelative, 1);
+
+  CPlacement3D &plSet = props[k_EField_plSet].GetPlacement();
+  const ULONG ulEntity = props[k_EField_ulEntity].GetIndex();
+
+  BOOL bDecoded = ReadCodedVector(nm, plSet.pl_PositionVector, FALSE, (bRelative ? NULL : GetBaselines(FALSE, FALSE)), ulEntity);
+  bDecoded &= ReadCodedVector(nm, plSet.pl_OrientationAngle, TRUE, (bRelative ? NULL : GetBaselines(FALSE, TRUE)), ulEntity);
+
+  if (!_bPatchFormat) nm.ReadBits(&bRelative, 1);
+  props[k_EField_bRelative].GetIndex() = bRelative;
+
+  // Don't apply a placement that couldn't be decoded
+  if (!bDecoded) {
+    props[k_EField_ulEntity].GetIndex() = 0x7FFFFFFF;
+  }
 };
 
 void CExtEntityTeleport::Process(void) {
@@ -42,11 +65,11 @@ void CExtEntityTeleport::Process(void) {
 
   if (!EntityExists(pen)) return;
 
-  CAnyValue &val = props["plSet"];
+  CAnyValue &val = props[k_EField_plSet];
   CPlacement3D pl = val.GetPlacement();
 
   // Relative to current position and orientation
-  if (props["bRelative"].IsTrue())
+  if (props[k_EField_bRelative].IsTrue())
   {
     pl.RelativeToAbsoluteSmooth(pen->GetPlacement());
   }
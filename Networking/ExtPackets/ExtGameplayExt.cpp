@@ -37,14 +37,14 @@ int CExtGameplayExt::FindVar(const CTString &strVar) {
 
 // Set string value
 void CExtGameplayExt::SetValue(const CTString &strVar, const CTString &str) {
-  props["iVar"] = FindVar(strVar);
-  props["value"] = str;
+  props[k_EField_iVar] = FindVar(strVar);
+  props[k_EField_value] = str;
 };
 
 // Set number value
 void CExtGameplayExt::SetValue(const CTString &strVar, DOUBLE f) {
-  props["iVar"] = FindVar(strVar);
-  props["value"] = f;
+  props[k_EField_iVar] = FindVar(strVar);
+  props[k_EField_value] = f;
 };
 
 bool CExtGameplayExt::Write(CNetworkMessage &nm) {
@@ -52,17 +52,17 @@ bool CExtGameplayExt::Write(CNetworkMessage &nm) {
 
   // It's not like there will ever be more than 16383 GEX variables,
   // plus if 'value' is 0.0, it'll all be neatly packed in just 2 bytes!
-  UWORD iVar = props["iVar"].GetIndex();
+  UWORD iVar = props[k_EField_iVar].GetIndex();
   if (iVar == 0) return false;
 
-  BOOL bString = (props["value"].GetType() == CAnyValue::E_VAL_STRING);
+  BOOL bString = (props[k_EField_value].GetType() == CAnyValue::E_VAL_STRING);
   nm.WriteBits(&iVar, 14);
   nm.WriteBits(&bString, 1);
 
   if (bString) {
-    nm << props["value"].ToString();
+    nm << props[k_EField_value].ToString();
   } else {
-    INetCompress::Double(nm, props["value"].ToFloat());
+    INetCompress::Double(nm, props[k_EField_value].ToFloat());
   }
 
   return true;
@@ -80,17 +80,17 @@ void CExtGameplayExt::Read(CNetworkMessage &nm) {
   nm.ReadBits(&iVar, 14);
   nm.ReadBits(&bString, 1);
 
-  props["iVar"] = (int)iVar;
+  props[k_EField_iVar] = (int)iVar;
 
   if (bString) {
     CTString strValue;
     nm >> strValue;
-    props["value"] = strValue;
+    props[k_EField_value] = strValue;
 
   } else {
     DOUBLE fValue;
     INetDecompress::Double(nm, fValue);
-    props["value"] = fValue;
+    props[k_EField_value] = fValue;
   }
 
 #endif // _PATCHCONFIG_GAMEPLAY_EXT
@@ -100,13 +100,13 @@ void CExtGameplayExt::Process(void) {
 #if _PATCHCONFIG_GAMEPLAY_EXT
 
   // Invalid offset
-  INDEX iGameplayExt = props["iVar"].GetIndex() - 1;
+  INDEX iGameplayExt = props[k_EField_iVar].GetIndex() - 1;
   if (iGameplayExt < 0 || iGameplayExt >= k_EGameplayExt_Max) return;
 
   IConfig::NamedValue &entry = IConfig::gex.props[iGameplayExt];
   CAnyValue::EType eType = entry.val.GetType();
 
-  bool bString = (props["value"].GetType() == CAnyValue::E_VAL_STRING);
+  bool bString = (props[k_EField_value].GetType() == CAnyValue::E_VAL_STRING);
 
   // Got a number but expected a string
   if (!bString && eType == CAnyValue::E_VAL_STRING) {
@@ -121,10 +121,10 @@ void CExtGameplayExt::Process(void) {
 
   // Set new value depending on type
   switch (eType) {
-    case CAnyValue::E_VAL_BOOL:   entry.val.GetIndex()  = props["value"].GetDouble(); break;
-    case CAnyValue::E_VAL_INDEX:  entry.val.GetIndex()  = props["value"].GetDouble(); break;
-    case CAnyValue::E_VAL_FLOAT:  entry.val.GetFloat()  = props["value"].GetDouble(); break;
-    case CAnyValue::E_VAL_STRING: entry.val.GetString() = props["value"].GetString(); break;
+    case CAnyValue::E_VAL_BOOL:   entry.val.GetIndex()  = props[k_EField_value].GetDouble(); break;
+    case CAnyValue::E_VAL_INDEX:  entry.val.GetIndex()  = props[k_EField_value].GetDouble(); break;
+    case CAnyValue::E_VAL_FLOAT:  entry.val.GetFloat()  = props[k_EField_value].GetDouble(); break;
+    case CAnyValue::E_VAL_STRING: entry.val.GetString() = props[k_EField_value].GetString(); break;
   }
 
 #else
@@ -82,67 +82,67 @@ static inline FLOAT DecompressPitch(UWORD uwPitch) {
 
 bool CExtPlaySound::Write(CNetworkMessage &nm)
 {
-  INDEX iChannel = props["iChannel"].GetIndex();
+  INDEX iChannel = props[k_EField_iChannel].GetIndex();
 
   // Invalid channel
   if (iChannel < 0 || iChannel > 31) {
     return false;
   }
 
-  nm << props["strFile"].GetString();
+  nm << props[k_EField_strFile].GetString();
 
   // Channel index occupies 5/16 bits
   nm.WriteBits(&iChannel, 5);
 
   // Flags occupy 11/16 bits
-  INDEX iFlags = props["ulFlags"].GetIndex();
+  INDEX iFlags = props[k_EField_ulFlags].GetIndex();
   nm.WriteBits(&iFlags, 11);
 
-  nm << props["fDelay"].GetFloat();
-  nm << props["fOffset"].GetFloat();
-  nm << CompressVolume(props["fVolumeL"].GetFloat());
-  nm << CompressVolume(props["fVolumeR"].GetFloat());
-  nm << CompressFilter(props["fFilterL"].GetFloat());
-  nm << CompressFilter(props["fFilterR"].GetFloat());
-  nm << CompressPitch(props["fPitch"].GetFloat());
+  nm << props[k_EField_fDelay].GetFloat();
+  nm << props[k_EField_fOffset].GetFloat();
+  nm << CompressVolume(props[k_EField_fVolumeL].GetFloat());
+  nm << CompressVolume(props[k_EField_fVolumeR].GetFloat());
+  nm << CompressFilter(props[k_EField_fFilterL].GetFloat());
+  nm << CompressFilter(props[k_EField_fFilterR].GetFloat());
+  nm << CompressPitch(props[k_EField_fPitch].GetFloat());
   return true;
 };
 
 void CExtPlaySound::Read(CNetworkMessage &nm) {
-  nm >> props["strFile"].GetString();
+  nm >> props[k_EField_strFile].GetString();
 
   // Channel index occupies 5/16 bits
   INDEX iChannel = 0;
   nm.ReadBits(&iChannel, 5);
-  props["iChannel"].GetIndex() = iChannel;
+  props[k_EField_iChannel].GetIndex() = iChannel;
 
   // Flags occupy 11/16 bits
   ULONG ulFlags = 0;
   nm.ReadBits(&ulFlags, 11);
-  props["ulFlags"].GetIndex() = ulFlags;
+  props[k_EField_ulFlags].GetIndex() = ulFlags;
 
-  nm >> props["fDelay"].GetFloat();
-  nm >> props["fOffset"].GetFloat();
+  nm >> props[k_EField_fDelay].GetFloat();
+  nm >> props[k_EField_fOffset].GetFloat();
 
   UBYTE ubVolume;
   UWORD uwFilter, uwPitch;
 
   nm >> ubVolume;
-  props["fVolumeL"].GetFloat() = DecompressVolume(ubVolume);
+  props[k_EField_fVolumeL].GetFloat() = DecompressVolume(ubVolume);
   nm >> ubVolume;
-  props["fVolumeR"].GetFloat() = DecompressVolume(ubVolume);
+  props[k_EField_fVolumeR].GetFloat() = DecompressVolume(ubVolume);
 
   nm >> uwFilter;
-  props["fFilterL"].GetFloat() = DecompressFilter(uwFilter);
+  props[k_EField_fFilterL].GetFloat() = DecompressFilter(uwFilter);
   nm >> uwFilter;
-  props["fFilterR"].GetFloat() = DecompressFilter(uwFilter);
+  props[k_EField_fFilterR].GetFloat() = DecompressFilter(uwFilter);
 
   nm >> uwPitch;
-  props["fPitch"].GetFloat() = DecompressPitch(uwPitch);
+  props[k_EField_fPitch].GetFloat() = DecompressPitch(uwPitch);
 };
 
 void CExtPlaySound::Process(void) {
-  INDEX iChannel = props["iChannel"].GetIndex();
+  INDEX iChannel = props[k_EField_iChannel].GetIndex();
 
   // Invalid channel
   if (iChannel < 0 || iChannel > 31) {
@@ -151,7 +151,7 @@ void CExtPlaySound::Process(void) {
   }
 
   CSoundObject &so = _asoChannels[iChannel];
-  CTString strFile = props["strFile"].GetString();
+  CTString strFile = props[k_EField_strFile].GetString();
 
   // Stop playing on a specific channel
   if (strFile == "/stop/") {
@@ -160,15 +160,15 @@ void CExtPlaySound::Process(void) {
   }
 
   // Set sound parameters for a specific channel
-  so.SetDelay(props["fDelay"].GetFloat());
-  so.SetVolume(props["fVolumeL"].GetFloat(), props["fVolumeR"].GetFloat());
-  so.SetFilter(props["fFilterL"].GetFloat(), props["fFilterR"].GetFloat());
-  so.SetPitch(props["fPitch"].GetFloat());
+  so.SetDelay(props[k_EField_fDelay].GetFloat());
+  so.SetVolume(props[k_EField_fVolumeL].GetFloat(), props[k_EField_fVolumeR].GetFloat());
+  so.SetFilter(props[k_EField_fFilterL].GetFloat(), props[k_EField_fFilterR].GetFloat());
+  so.SetPitch(props[k_EField_fPitch].GetFloat());
 
   // Play a new sound
   if (strFile != "") {
     try {
-      so.Play_t(strFile, props["ulFlags"].GetIndex());
+      so.Play_t(strFile, props[k_EField_ulFlags].GetIndex());
     } catch (char *strError) {
       ClassicsPackets_ServerReport(this, TRANS("Cannot play '%s' sound: %s\n"), strFile.str_String, strError);
     }
@@ -177,7 +177,7 @@ void CExtPlaySound::Process(void) {
   }
 
   // Set offset after playing the sound
-  const FLOAT fOffset = props["fOffset"].GetFloat();
+  const FLOAT fOffset = props[k_EField_fOffset].GetFloat();
   ISounds::SetOffset(so, fOffset, fOffset);
 };
 
@@ -28,6 +28,46 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 // Up to 64 possible characters in a path string (least used are last)
 static const char *_achCompressedPathCharacters = "_ABCDEFGHIJKLMNOPQRSTUVWXYZ.\\0123456789 -()!+='&,;[]{}`$%#@~";
 
+// Reverse lookup table of path characters
+struct SPathCharTable {
+  UBYTE aubIndices[256];
+
+  SPathCharTable() {
+    // Unknown characters act as the first one
+    memset(aubIndices, 0, sizeof(aubIndices));
+
+    // Go backwards so the first occurrence wins (including the null terminator)
+    for (INDEX i = 60; i >= 0; i--) {
+      aubIndices[(UBYTE)_achCompressedPathCharacters[i]] = (UBYTE)i;
+    }
+  };
+};
+
+static const SPathCharTable _pctCompressedPathCharacters;
+
+// Quantize value to a fixed-point precision (returns FALSE if it doesn't fit)
+inline BOOL QuantizeFixed(FLOAT f, UBYTE ubBits, SLONG &slValue) {
+  const DOUBLE dScaled = (DOUBLE)f * (DOUBLE)(1UL << ubBits);
+
+  // Also catches NaN
+  if (!(dScaled > -1073741824.0 && dScaled < 1073741824.0)) return FALSE;
+
+  slValue = (SLONG)floor(dScaled + 0.5);
+  return TRUE;
+};
+
+// Restore value from a fixed-point precision
+inline FLOAT DequantizeFixed(SLONG slValue, UBYTE ubBits) {
+  return FLOAT((DOUBLE)slValue / (DOUBLE)(1UL << ubBits));
+};
+
+// Placement coding modes (written as 2 bits in front of the values)
+enum EPlacementCoding {
+  k_EPlacementCoding_Raw       = 0, // Zero flags and full 32-bit floats
+  k_EPlacementCoding_Quantized = 1, // Fixed-point values with a declared precision
+  k_EPlacementCoding_Delta     = 2, // Fixed-point difference from a baseline known to every client
+};
+
 // Interface with methods for compressing data into network packets
 namespace INetCompress {
 
@@ -68,17 +108,16 @@ inline void Integer(CNetworkMessage &nm, ULONG ul) {
   }
 };
 
+// Compress signed 32-bit integer
+inline void SignedInteger(CNetworkMessage &nm, SLONG sl) {
+  // Interleave negative values with positive ones to keep small magnitudes short
+  Integer(nm, (ULONG(sl) << 1) ^ ULONG(sl >> 31));
+};
+
 // Compress path character
 inline char PathChar(CNetworkMessage &nm, char ch) {
   ch = toupper(ch);
-  UBYTE ubChar = 0; // First character can act as invalid one
-
-  for (UBYTE i = 0; i < 61; i++) {
-    if (ch == _achCompressedPathCharacters[i]) {
-      ubChar = i;
-      break;
-    }
-  }
+  UBYTE ubChar = _pctCompressedPathCharacters.aubIndices[(UBYTE)ch];
 
   nm.WriteBits(&ubChar, 6);
   return _achCompressedPathCharacters[ubChar];
@@ -148,6 +187,63 @@ inline void Placement(CNetworkMessage &nm, const CPlacement3D &pl) {
   Angle3D(nm, pl.pl_OrientationAngle);
 };
 
+// Compress vector using a specific placement coding and output the value that will be decompressed
+// Delta falls back to quantized values without a baseline and either one falls back to raw values if they don't fit
+inline void CodedFloat3D(CNetworkMessage &nm, const FLOAT3D &v, INDEX iCoding, UBYTE ubBits, const FLOAT3D *pvBase, FLOAT3D &vCoded) {
+  SLONG aslValues[3];
+
+  if (iCoding == k_EPlacementCoding_Delta && pvBase == NULL) {
+    iCoding = k_EPlacementCoding_Quantized;
+  }
+
+  if (iCoding != k_EPlacementCoding_Raw) {
+    for (INDEX i = 0; i < 3; i++) {
+      if (!QuantizeFixed(v(i + 1), ubBits, aslValues[i])) {
+        iCoding = k_EPlacementCoding_Raw;
+        break;
+      }
+
+      vCoded(i + 1) = DequantizeFixed(aslValues[i], ubBits);
+
+      if (iCoding != k_EPlacementCoding_Delta) continue;
+
+      SLONG slBase;
+
+      if (!QuantizeFixed((*pvBase)(i + 1), ubBits, slBase)) {
+        iCoding = k_EPlacementCoding_Raw;
+        break;
+      }
+
+      aslValues[i] -= slBase;
+    }
+  }
+
+  UBYTE ub = (UBYTE)iCoding;
+  nm.WriteBits(&ub, 2);
+
+  // Raw values that are close to zero are written as zero
+  if (iCoding == k_EPlacementCoding_Raw) {
+    Float3D(nm, v);
+
+    for (INDEX i = 1; i <= 3; i++) {
+      vCoded(i) = (v(i) > -0.001f && v(i) < 0.001f) ? 0.0f : v(i);
+    }
+    return;
+  }
+
+  // Declared precision
+  nm.WriteBits(&ubBits, 5);
+
+  for (INDEX i = 0; i < 3; i++) {
+    ub = (aslValues[i] != 0);
+    nm.WriteBits(&ub, 1);
+
+    if (ub) {
+      SignedInteger(nm, aslValues[i]);
+    }
+  }
+};
+
 }; // namespace
 
 // Interface with methods for decompressing data from network packets
@@ -179,6 +275,14 @@ inline void Integer(CNetworkMessage &nm, ULONG &ul) {
   }
 };
 
+// Decompress signed 32-bit integer
+inline void SignedInteger(CNetworkMessage &nm, SLONG &sl) {
+  ULONG ul;
+  Integer(nm, ul);
+
+  sl = SLONG(ul >> 1) ^ -SLONG(ul & 1);
+};
+
 // Decompress path character
 inline char PathChar(CNetworkMessage &nm) {
   UBYTE ubChar = 0;
@@ -247,6 +351,45 @@ inline void Placement(CNetworkMessage &nm, CPlacement3D &pl) {
   Angle3D(nm, pl.pl_OrientationAngle);
 };
 
+// Decompress vector using whichever placement coding it has been written with
+// Returns FALSE if it's a delta without a baseline
+inline BOOL CodedFloat3D(CNetworkMessage &nm, FLOAT3D &v, const FLOAT3D *pvBase) {
+  UBYTE ubCoding = 0;
+  nm.ReadBits(&ubCoding, 2);
+
+  if (ubCoding == k_EPlacementCoding_Raw) {
+    Float3D(nm, v);
+    return TRUE;
+  }
+
+  // Declared precision
+  UBYTE ubBits = 0;
+  nm.ReadBits(&ubBits, 5);
+
+  const BOOL bDelta = (ubCoding == k_EPlacementCoding_Delta);
+
+  for (INDEX i = 1; i <= 3; i++) {
+    UBYTE ub = 0;
+    nm.ReadBits(&ub, 1);
+
+    SLONG slValue = 0;
+
+    if (ub) {
+      SignedInteger(nm, slValue);
+    }
+
+    SLONG slBase;
+
+    if (bDelta && pvBase != NULL && QuantizeFixed((*pvBase)(i), ubBits, slBase)) {
+      slValue += slBase;
+    }
+
+    v(i) = DequantizeFixed(slValue, ubBits);
+  }
+
+  return (!bDelta || pvBase != NULL);
+};
+
 }; // namespace
 
 #endif
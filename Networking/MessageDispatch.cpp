@@ -0,0 +1,389 @@
+/* Copyright (c) 2022-2024 Dreamy Cecil
+This program is free software; you can redistribute it and/or modify
+it under the terms of version 2 of the GNU General Public License as published by
+the Free Software Foundation
+
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#include "StdH.h"
+
+#include "MessageDispatch.h"
+#include "NetworkFunctions.h"
+
+// Maximum amount of different extension packet types with their own statistics
+// Entries are only added for built-in and registered types, and packets of any other types are accounted for together
+#define MAX_EXT_ENTRIES 128
+
+// Slots in the tables of extension packet entries (twice as many to keep probing short)
+#define EXT_TABLE_SLOTS (MAX_EXT_ENTRIES * 2)
+
+// Entry of a message type in the dispatch table
+struct SServerEntry {
+  FServerMessageHandler pHandler;
+  SMessageStats stats;
+};
+
+struct SClientEntry {
+  FClientMessageHandler pHandler;
+  SMessageStats stats;
+};
+
+// Entry of an extension packet type
+struct SExtEntry {
+  BOOL bUsed;
+  ULONG ulType;
+  FExtPacketHandler pHandler;
+  SMessageStats stats;
+};
+
+// Open addressing table of extension packet entries indexed by packet types
+// Built-in types are small enough to occupy their own slots
+struct SExtTable {
+  SExtEntry aEntries[EXT_TABLE_SLOTS];
+  INDEX ctEntries;
+
+  // Packets of types without entries
+  SMessageStats statsOther;
+};
+
+// Dispatch tables indexed by message types
+static SServerEntry _aServerEntries[IMessageDispatch::MAX_MESSAGE_TYPES];
+static SClientEntry _aClientEntries[IMessageDispatch::MAX_MESSAGE_TYPES];
+
+// Extension packet entries by packet types
+static SExtTable _tblServerExt;
+static SExtTable _tblClientExt;
+
+// Get current time in timer ticks
+static inline SQUAD GetTicks(void) {
+  return _pTimer->GetHighPrecisionTimer().tv_llValue;
+};
+
+// Find entry of an extension packet type (NULL if none)
+static SExtEntry *FindExtEntry(SExtTable &tbl, ULONG ulType, BOOL bCreate) {
+  const ULONG ulMask = EXT_TABLE_SLOTS - 1;
+  ULONG ulSlot = ulType & ulMask;
+
+  for (; tbl.aEntries[ulSlot].bUsed; ulSlot = (ulSlot + 1) & ulMask) {
+    if (tbl.aEntries[ulSlot].ulType == ulType) return &tbl.aEntries[ulSlot];
+  }
+
+  // Don't add any more entries
+  if (!bCreate || tbl.ctEntries >= MAX_EXT_ENTRIES) return NULL;
+
+  SExtEntry &entry = tbl.aEntries[ulSlot];
+  entry.bUsed = TRUE;
+  entry.ulType = ulType;
+  entry.pHandler = NULL;
+  entry.stats.Reset();
+
+  tbl.ctEntries++;
+  return &entry;
+};
+
+// Check if packets of some type are built into the patch
+static BOOL IsBuiltInExtType(ULONG ulType, BOOL bFromServer) {
+#if _PATCHCONFIG_EXT_PACKETS
+  if (bFromServer) {
+    return (ulType <= IClassicsExtPacket::k_EPacketType_LastS2C);
+  }
+#endif
+
+  // No built-in packets from clients (see CExtPacket::CreatePacket())
+  return FALSE;
+};
+
+// Dispatch extension packet through one of the tables
+static BOOL DispatchExt(SExtTable &tbl, BOOL bFromServer, CNetworkMessage &nmMessage, ULONG ulType, FExtPacketHandler pFallback) {
+  const SQUAD llStart = GetTicks();
+
+  // Packets of unknown types don't get their own entries
+  SExtEntry *pEntry = FindExtEntry(tbl, ulType, IsBuiltInExtType(ulType, bFromServer));
+  FExtPacketHandler pHandler = (pEntry != NULL ? pEntry->pHandler : NULL);
+
+  BOOL bHandled = FALSE;
+
+  // Let the registered handler try it first
+  if (pHandler != NULL) {
+    bHandled = pHandler(nmMessage, ulType);
+  }
+
+  if (!bHandled && pFallback != NULL) {
+    bHandled = pFallback(nmMessage, ulType);
+  }
+
+  SMessageStats &stats = (pEntry != NULL ? pEntry->stats : tbl.statsOther);
+  stats.Add(nmMessage.nm_slSize, GetTicks() - llStart);
+
+  return bHandled;
+};
+
+// Set handler of messages from clients (NULL to pass them into the engine)
+void IMessageDispatch::SetServerHandler(INDEX iType, FServerMessageHandler pHandler) {
+  ASSERT(iType >= 0 && iType < MAX_MESSAGE_TYPES);
+  if (iType < 0 || iType >= MAX_MESSAGE_TYPES) return;
+
+  _aServerEntries[iType].pHandler = pHandler;
+};
+
+// Set handler of messages from a server (NULL to pass them into the engine)
+void IMessageDispatch::SetClientHandler(INDEX iType, FClientMessageHandler pHandler) {
+  ASSERT(iType >= 0 && iType < MAX_MESSAGE_TYPES);
+  if (iType < 0 || iType >= MAX_MESSAGE_TYPES) return;
+
+  _aClientEntries[iType].pHandler = pHandler;
+};
+
+// Set handler of extension packets from clients, instead of inspecting every packet (NULL to remove)
+void IMessageDispatch::SetServerExtHandler(ULONG ulType, FExtPacketHandler pHandler) {
+  SExtEntry *pEntry = FindExtEntry(_tblServerExt, ulType, TRUE);
+
+  if (pEntry == NULL) {
+    CPrintF(TRANS("Cannot register handler of client packets of type %u: too many packet types!\n"), ulType);
+    return;
+  }
+
+  pEntry->pHandler = pHandler;
+};
+
+// Set handler of extension packets from a server, instead of inspecting every packet (NULL to remove)
+void IMessageDispatch::SetClientExtHandler(ULONG ulType, FExtPacketHandler pHandler) {
+  SExtEntry *pEntry = FindExtEntry(_tblClientExt, ulType, TRUE);
+
+  if (pEntry == NULL) {
+    CPrintF(TRANS("Cannot register handler of server packets of type %u: too many packet types!\n"), ulType);
+    return;
+  }
+
+  pEntry->pHandler = pHandler;
+};
+
+// Dispatch message from a client to its handler
+// If output is TRUE, it will pass the message into engine's CServer::Handle()
+BOOL IMessageDispatch::Server(INDEX iClient, CNetworkMessage &nmMessage) {
+  const INDEX iType = nmMessage.GetType();
+  if (iType < 0 || iType >= MAX_MESSAGE_TYPES) return TRUE;
+
+  const SQUAD llStart = GetTicks();
+  SServerEntry &entry = _aServerEntries[iType];
+
+  // Pass messages without handlers into the engine
+  BOOL bPass = TRUE;
+
+  if (entry.pHandler != NULL) {
+    bPass = entry.pHandler(iClient, nmMessage);
+  }
+
+  entry.stats.Add(nmMessage.nm_slSize, GetTicks() - llStart);
+  return bPass;
+};
+
+// Dispatch message from a server to its handler
+// If output is TRUE, it will pass the message into engine's CSessionState::ProcessGameStreamBlock()
+BOOL IMessageDispatch::Client(CSessionState *pses, CNetworkMessage &nmMessage) {
+  const INDEX iType = nmMessage.GetType();
+  if (iType < 0 || iType >= MAX_MESSAGE_TYPES) return TRUE;
+
+  const SQUAD llStart = GetTicks();
+  SClientEntry &entry = _aClientEntries[iType];
+
+  // Pass messages without handlers into the engine
+  BOOL bPass = TRUE;
+
+  if (entry.pHandler != NULL) {
+    bPass = entry.pHandler(pses, nmMessage);
+  }
+
+  entry.stats.Add(nmMessage.nm_slSize, GetTicks() - llStart);
+  return bPass;
+};
+
+// Dispatch extension packet from a client to its handler (after reading the type)
+// Packets without a registered handler or the ones it didn't handle are passed into the fallback one
+BOOL IMessageDispatch::ServerExt(CNetworkMessage &nmMessage, ULONG ulType, FExtPacketHandler pFallback) {
+  return DispatchExt(_tblServerExt, FALSE, nmMessage, ulType, pFallback);
+};
+
+// Dispatch extension packet from a server to its handler (after reading the type)
+// Packets without a registered handler or the ones it didn't handle are passed into the fallback one
+BOOL IMessageDispatch::ClientExt(CNetworkMessage &nmMessage, ULONG ulType, FExtPacketHandler pFallback) {
+  return DispatchExt(_tblClientExt, TRUE, nmMessage, ulType, pFallback);
+};
+
+// Get statistics of messages from clients of a specific type
+const SMessageStats &IMessageDispatch::GetServerStats(INDEX iType) {
+  ASSERT(iType >= 0 && iType < MAX_MESSAGE_TYPES);
+  return _aServerEntries[Clamp(iType, (INDEX)0, (INDEX)MAX_MESSAGE_TYPES - 1)].stats;
+};
+
+// Get statistics of messages from a server of a specific type
+const SMessageStats &IMessageDispatch::GetClientStats(INDEX iType) {
+  ASSERT(iType >= 0 && iType < MAX_MESSAGE_TYPES);
+  return _aClientEntries[Clamp(iType, (INDEX)0, (INDEX)MAX_MESSAGE_TYPES - 1)].stats;
+};
+
+// Reset all statistics
+void IMessageDispatch::ResetStats(void) {
+  INDEX i;
+
+  for (i = 0; i < MAX_MESSAGE_TYPES; i++) {
+    _aServerEntries[i].stats.Reset();
+    _aClientEntries[i].stats.Reset();
+  }
+
+  for (i = 0; i < EXT_TABLE_SLOTS; i++) {
+    _tblServerExt.aEntries[i].stats.Reset();
+    _tblClientExt.aEntries[i].stats.Reset();
+  }
+
+  _tblServerExt.statsOther.Reset();
+  _tblClientExt.statsOther.Reset();
+};
+
+// Get name of a known message type (NULL if unknown)
+static const char *GetMessageName(INDEX iType) {
+  switch (iType) {
+    case MSG_REQ_CONNECTREMOTESESSIONSTATE: return "MSG_REQ_CONNECTREMOTESESSIONSTATE";
+    case MSG_REQ_CONNECTPLAYER: return "MSG_REQ_CONNECTPLAYER";
+    case MSG_REQ_CHARACTERCHANGE: return "MSG_REQ_CHARACTERCHANGE";
+    case MSG_REQ_STATEDELTA: return "MSG_REQ_STATEDELTA";
+    case MSG_ACTION: return "MSG_ACTION";
+    case MSG_SYNCCHECK: return "MSG_SYNCCHECK";
+    case MSG_CHAT_IN: return "MSG_CHAT_IN";
+    case MSG_SEQ_ADDPLAYER: return "MSG_SEQ_ADDPLAYER";
+    case MSG_SEQ_CHARACTERCHANGE: return "MSG_SEQ_CHARACTERCHANGE";
+    case INetwork::PCK_REP_DISCONNECTED: return "PCK_REP_DISCONNECTED";
+
+  #if _PATCHCONFIG_EXT_PACKETS
+    case INetwork::PCK_EXTENSION_BATCH: return "PCK_EXTENSION_BATCH";
+    case INetwork::PCK_EXTENSION: return "PCK_EXTENSION";
+  #endif
+  }
+
+  return NULL;
+};
+
+// Print one line of statistics
+static void PrintStatsLine(CTString &strOut, const CTString &strName, const SMessageStats &stats) {
+  // Nothing to print
+  if (stats.ulCount == 0) return;
+
+  const DOUBLE dTotalMs = CTimerValue(stats.llTotalTime).GetSeconds() * 1000.0;
+  const DOUBLE dMaxMs = CTimerValue(stats.llMaxTime).GetSeconds() * 1000.0;
+
+  CTString strLine;
+  strLine.PrintF("  %-36s %8u %10.1fk %10.3f ms %8.4f ms %8.3f ms\n", strName.str_String, stats.ulCount,
+    stats.llBytes / 1024.0, dTotalMs, dTotalMs / stats.ulCount, dMaxMs);
+
+  strOut += strLine;
+};
+
+// Print statistics of one dispatch table
+template<class Entry> static void PrintTableStats(CTString &strOut, const Entry *aEntries) {
+  for (INDEX i = 0; i < IMessageDispatch::MAX_MESSAGE_TYPES; i++) {
+    const char *strType = GetMessageName(i);
+
+    CTString strName;
+
+    if (strType != NULL) {
+      strName.PrintF("%s (%d)", strType, i);
+    } else {
+      strName.PrintF("%d", i);
+    }
+
+    PrintStatsLine(strOut, strName, aEntries[i].stats);
+  }
+};
+
+// Print statistics of extension packet types
+static void PrintExtStats(CTString &strOut, const SExtTable &tbl) {
+  for (INDEX i = 0; i < EXT_TABLE_SLOTS; i++) {
+    const SExtEntry &entry = tbl.aEntries[i];
+    if (!entry.bUsed) continue;
+
+    CTString strName;
+    strName.PrintF("PCK_EXTENSION type %u", entry.ulType);
+
+    PrintStatsLine(strOut, strName, entry.stats);
+  }
+
+  PrintStatsLine(strOut, "PCK_EXTENSION other types", tbl.statsOther);
+};
+
+// Print all statistics into a string
+void IMessageDispatch::PrintStats(CTString &strOut) {
+  const CTString strHeader(TRANS("  Type                                    Count       Size      Total time    Average      Maximum\n"));
+
+  strOut = TRANS("Messages from clients:\n");
+  strOut += strHeader;
+  PrintTableStats(strOut, _aServerEntries);
+  PrintExtStats(strOut, _tblServerExt);
+
+  strOut += TRANS("\nMessages from a server:\n");
+  strOut += strHeader;
+  PrintTableStats(strOut, _aClientEntries);
+  PrintExtStats(strOut, _tblClientExt);
+
+  strOut += TRANS("\nTime of PCK_EXTENSION_BATCH and PCK_EXTENSION includes time of the packets inside them.\n");
+  strOut += TRANS("Time of messages without handlers doesn't include engine processing.\n");
+};
+
+// Write all statistics into a file
+BOOL IMessageDispatch::DumpStats(const CTString &fnmFile) {
+  CTString strStats;
+  PrintStats(strStats);
+
+  // Make sure the directory exists
+  IDir::CreateDir(fnmFile);
+
+  try {
+    CTFileStream strm;
+    strm.Create_t(fnmFile);
+    strm.PutString_t(strStats);
+    strm.Close();
+
+  } catch (char *strError) {
+    CPrintF(TRANS("Cannot dump message statistics: %s\n"), strError);
+    return FALSE;
+  }
+
+  return TRUE;
+};
+
+// Print message statistics into the console
+static void PrintMessageStats(void) {
+  CTString strStats;
+  IMessageDispatch::PrintStats(strStats);
+
+  CPutString(strStats);
+};
+
+// Write message statistics into a file
+static void DumpMessageStats(SHELL_FUNC_ARGS) {
+  BEGIN_SHELL_FUNC;
+  const CTString &strFile = *NEXT_ARG(CTString *);
+
+  if (IMessageDispatch::DumpStats(strFile)) {
+    CPrintF(TRANS("Dumped message statistics into '%s'\n"), strFile.str_String);
+  }
+};
+
+// Reset message statistics
+static void ResetMessageStats(void) {
+  IMessageDispatch::ResetStats();
+};
+
+// Register commands
+void IMessageDispatch::Initialize(void) {
+  _pShell->DeclareSymbol("user void net_PrintMessageStats(void);", &PrintMessageStats);
+  _pShell->DeclareSymbol("user void net_DumpMessageStats(CTString);", &DumpMessageStats);
+  _pShell->DeclareSymbol("user void net_ResetMessageStats(void);", &ResetMessageStats);
+};
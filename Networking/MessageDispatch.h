@@ -0,0 +1,117 @@
+/* Copyright (c) 2022-2024 Dreamy Cecil
+This program is free software; you can redistribute it and/or modify
+it under the terms of version 2 of the GNU General Public License as published by
+the Free Software Foundation
+
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA. */
+
+#ifndef CECIL_INCL_MESSAGEDISPATCH_H
+#define CECIL_INCL_MESSAGEDISPATCH_H
+
+#ifdef PRAGMA_ONCE
+  #pragma once
+#endif
+
+// Handler of messages of a specific type coming from a client
+// If output is TRUE, it will pass the message into engine's CServer::Handle()
+typedef BOOL (*FServerMessageHandler)(INDEX iClient, CNetworkMessage &nmMessage);
+
+// Handler of messages of a specific type coming from a server
+// If output is TRUE, it will pass the message into engine's CSessionState::ProcessGameStreamBlock()
+typedef BOOL (*FClientMessageHandler)(CSessionState *pses, CNetworkMessage &nmMessage);
+
+// Handler of extension packets of a specific type (called after reading the type)
+// If output is TRUE, the packet has been handled and isn't passed any further
+typedef BOOL (*FExtPacketHandler)(CNetworkMessage &nmMessage, ULONG ulType);
+
+// Statistics of handling messages of one type
+struct CORE_API SMessageStats {
+  ULONG ulCount;     // Handled messages
+  SQUAD llBytes;     // Total size of handled messages
+  SQUAD llTotalTime; // Total handling time (in timer ticks)
+  SQUAD llMaxTime;   // Longest handling time (in timer ticks)
+
+  SMessageStats() {
+    Reset();
+  };
+
+  inline void Reset(void) {
+    ulCount = 0;
+    llBytes = 0;
+    llTotalTime = 0;
+    llMaxTime = 0;
+  };
+
+  // Account for one handled message
+  inline void Add(SLONG slBytes, SQUAD llTime) {
+    ulCount++;
+    llBytes += slBytes;
+    llTotalTime += llTime;
+    if (llTime > llMaxTime) llMaxTime = llTime;
+  };
+};
+
+// Registration-based dispatching of network messages by their types
+// Every dispatched message is accounted for in the statistics of its type, even without a handler
+class CORE_API IMessageDispatch {
+  public:
+    // Amount of message types (MESSAGETYPE cannot go above 63)
+    enum { MAX_MESSAGE_TYPES = 64 };
+
+  public:
+    // Register commands
+    static void Initialize(void);
+
+    // Set handler of messages from clients (NULL to pass them into the engine)
+    static void SetServerHandler(INDEX iType, FServerMessageHandler pHandler);
+
+    // Set handler of messages from a server (NULL to pass them into the engine)
+    static void SetClientHandler(INDEX iType, FClientMessageHandler pHandler);
+
+    // Set handler of extension packets from clients, instead of inspecting every packet (NULL to remove)
+    static void SetServerExtHandler(ULONG ulType, FExtPacketHandler pHandler);
+
+    // Set handler of extension packets from a server, instead of inspecting every packet (NULL to remove)
+    static void SetClientExtHandler(ULONG ulType, FExtPacketHandler pHandler);
+
+    // Dispatch message from a client to its handler
+    // If output is TRUE, it will pass the message into engine's CServer::Handle()
+    static BOOL Server(INDEX iClient, CNetworkMessage &nmMessage);
+
+    // Dispatch message from a server to its handler
+    // If output is TRUE, it will pass the message into engine's CSessionState::ProcessGameStreamBlock()
+    static BOOL Client(CSessionState *pses, CNetworkMessage &nmMessage);
+
+    // Dispatch extension packet from a client to its handler (after reading the type)
+    // Packets without a registered handler or the ones it didn't handle are passed into the fallback one
+    static BOOL ServerExt(CNetworkMessage &nmMessage, ULONG ulType, FExtPacketHandler pFallback);
+
+    // Dispatch extension packet from a server to its handler (after reading the type)
+    // Packets without a registered handler or the ones it didn't handle are passed into the fallback one
+    static BOOL ClientExt(CNetworkMessage &nmMessage, ULONG ulType, FExtPacketHandler pFallback);
+
+    // Get statistics of messages from clients of a specific type
+    static const SMessageStats &GetServerStats(INDEX iType);
+
+    // Get statistics of messages from a server of a specific type
+    static const SMessageStats &GetClientStats(INDEX iType);
+
+    // Reset all statistics
+    static void ResetStats(void);
+
+    // Print all statistics into a string
+    static void PrintStats(CTString &strOut);
+
+    // Write all statistics into a file
+    static BOOL DumpStats(const CTString &fnmFile);
+};
+
+#endif
@@ -18,6 +18,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "MessageProcessing.h"
 #include "NetworkFunctions.h"
 #include "Modules.h"
+#include "ExtPackets.h"
 
 #include "Query/QueryManager.h"
 
@@ -98,14 +99,30 @@ void IProcessPacket::ClearSyncChecks(void)
 
 #endif // _PATCHCONFIG_GUID_MASKING
 
+// [Cecil] Position of the newest sync check in each array
+// Sync checks are kept in a ring that's ordered by time, so the oldest one always follows the newest one
+#if _PATCHCONFIG_GUID_MASKING
+  static INDEX _aiNewestCheck[ICore::MAX_GAME_PLAYERS];
+#else
+  static INDEX _iNewestCheck = 0;
+#endif
+
+// [Cecil] Get sync check at some position in the ring, starting from the oldest one
+static inline CSyncCheck &GetSyncCheckInRing(IProcessPacket::CSyncCheckArray &aChecks, INDEX iNewest, INDEX iPos) {
+  return aChecks[(iNewest + 1 + iPos) % aChecks.Count()];
+};
+
 // Buffer sync check for the server
 void IProcessPacket::AddSyncCheck(const INDEX iClient, const CSyncCheck &sc)
 {
 #if _PATCHCONFIG_GUID_MASKING
   // Use the first array if not masking
-  CSyncCheckArray &aChecks = _aClientChecks[ShouldMaskGUIDs() ? iClient : 0];
+  const INDEX iArray = ShouldMaskGUIDs() ? iClient : 0;
+  CSyncCheckArray &aChecks = _aClientChecks[iArray];
+  INDEX &iNewest = _aiNewestCheck[iArray];
 #else
   CSyncCheckArray &aChecks = _pNetwork->ga_srvServer.srv_ascChecks;
+  INDEX &iNewest = _iNewestCheck;
 #endif
 
   // Recreate the buffer if the size differs
@@ -113,23 +130,38 @@ void IProcessPacket::AddSyncCheck(const INDEX iClient, const CSyncCheck &sc)
   INDEX &iBuffer = symptr.GetIndex();
 
   iBuffer = ClampDn(iBuffer, (INDEX)1);
+  const INDEX ctChecks = iBuffer;
 
-  if (aChecks.Count() != iBuffer) {
+  if (aChecks.Count() != ctChecks || iNewest < 0 || iNewest >= ctChecks) {
     aChecks.Clear();
-    aChecks.New(iBuffer);
-  }
+    aChecks.New(ctChecks);
 
-  // Find the oldest one
-  INDEX iOldest = 0;
+    // Empty checks are all the same, so start writing from the beginning
+    iNewest = ctChecks - 1;
+  }
 
-  for (INDEX i = 1; i < aChecks.Count(); i++) {
-    if (aChecks[i].sc_tmTick < aChecks[iOldest].sc_tmTick) {
-      iOldest = i;
-    }
+  // [Cecil] Overwrite the oldest one, which is right after the newest one
+  if (sc.sc_tmTick >= aChecks[iNewest].sc_tmTick) {
+    iNewest = (iNewest + 1) % ctChecks;
+    aChecks[iNewest] = sc;
+    return;
   }
 
-  // Overwrite it
-  aChecks[iOldest] = sc;
+  // [Cecil] If going back in time (e.g. after a level change), still overwrite the oldest one
+  // but then move it forward to keep the ring ordered by time
+  INDEX iPos = 0;
+  GetSyncCheckInRing(aChecks, iNewest, 0) = sc;
+
+  for (; iPos < ctChecks - 1; iPos++) {
+    CSyncCheck &scCurrent = GetSyncCheckInRing(aChecks, iNewest, iPos);
+    CSyncCheck &scNext = GetSyncCheckInRing(aChecks, iNewest, iPos + 1);
+
+    if (scNext.sc_tmTick >= scCurrent.sc_tmTick) break;
+
+    CSyncCheck scSwap = scCurrent;
+    scCurrent = scNext;
+    scNext = scSwap;
+  }
 };
 
 // Find buffered sync check for a given tick
@@ -137,40 +169,72 @@ INDEX IProcessPacket::FindSyncCheck(const INDEX iClient, TIME tmTick, CSyncCheck
 {
 #if _PATCHCONFIG_GUID_MASKING
   // Use the first array if not masking
-  CSyncCheckArray &aChecks = _aClientChecks[ShouldMaskGUIDs() ? iClient : 0];
+  const INDEX iArray = ShouldMaskGUIDs() ? iClient : 0;
+  CSyncCheckArray &aChecks = _aClientChecks[iArray];
+  const INDEX iNewest = _aiNewestCheck[iArray];
 #else
   CSyncCheckArray &aChecks = _pNetwork->ga_srvServer.srv_ascChecks;
+  const INDEX iNewest = _iNewestCheck;
 #endif
 
-  BOOL bHasEarlier = FALSE;
-  BOOL bHasLater = FALSE;
+  const INDEX ctChecks = aChecks.Count();
 
-  for (INDEX i = 0; i < aChecks.Count(); i++) {
-    TIME tmInTable = aChecks[i].sc_tmTick;
+  // Nothing has been buffered yet
+  if (ctChecks == 0 || iNewest < 0 || iNewest >= ctChecks) {
+    return -1;
+  }
 
-    if (tmInTable == tmTick) {
-      sc = aChecks[i];
-      return 0;
+  // [Cecil] Earlier than the oldest one
+  if (tmTick < GetSyncCheckInRing(aChecks, iNewest, 0).sc_tmTick) {
+    return -1;
+  }
 
-    } else if (tmInTable < tmTick) {
-      bHasEarlier = TRUE;
+  // [Cecil] Later than the newest one
+  const CSyncCheck &scNewest = aChecks[iNewest];
 
-    } else if (tmInTable > tmTick) {
-      bHasLater = TRUE;
+  if (tmTick > scNewest.sc_tmTick) {
+    return +1;
+  }
+
+  // [Cecil] Sync checks are made at regular intervals, so guess the position from the last interval
+  if (ctChecks > 1) {
+    const TIME tmInterval = scNewest.sc_tmTick - GetSyncCheckInRing(aChecks, iNewest, ctChecks - 2).sc_tmTick;
+
+    if (tmInterval > 0) {
+      const INDEX iBack = (INDEX)floor((scNewest.sc_tmTick - tmTick) / tmInterval + 0.5);
+
+      if (iBack >= 0 && iBack < ctChecks) {
+        const CSyncCheck &scGuess = GetSyncCheckInRing(aChecks, iNewest, ctChecks - 1 - iBack);
+
+        if (scGuess.sc_tmTick == tmTick) {
+          sc = scGuess;
+          return 0;
+        }
+      }
     }
   }
 
-  if (!bHasEarlier) {
-    ASSERT(bHasLater);
-    return -1;
+  // [Cecil] Otherwise search for it in the ordered ring
+  INDEX iMin = 0;
+  INDEX iMax = ctChecks - 1;
 
-  } else if (!bHasLater) {
-    ASSERT(bHasEarlier);
-    return +1;
+  while (iMin <= iMax) {
+    const INDEX iMid = (iMin + iMax) / 2;
+    const CSyncCheck &scMid = GetSyncCheckInRing(aChecks, iNewest, iMid);
+
+    if (scMid.sc_tmTick == tmTick) {
+      sc = scMid;
+      return 0;
+    }
+
+    if (scMid.sc_tmTick < tmTick) {
+      iMin = iMid + 1;
+    } else {
+      iMax = iMid - 1;
+    }
   }
 
-  // Cannot have earlier, later and not found all at once
-  ASSERT(FALSE);
+  // Between buffered sync checks but not found
   return +1;
 };
 
@@ -333,8 +397,12 @@ void IProcessPacket::OnConnectRemoteSessionStateRequest(INDEX iClient, CNetworkM
   // [Cecil] Check if vanilla clients are forbidden or using incompatible gameplay extensions
   const BOOL bForbid = (_bForbidVanilla || GameplayExtEnabled());
 
+  // [Cecil] Check if the client has the right patch version installed
+  const BOOL bPatchClient = CheckClientPatch(iClient, nmMessage);
+  _aActiveClients[iClient].bPatchClient = bPatchClient;
+
   // [Cecil] Disconnect unless the client has the right patch version installed
-  if (bForbid && !CheckClientPatch(iClient, nmMessage)) {
+  if (bForbid && !bPatchClient) {
     // Prompt to download the right patch version
     const CTString strVer = ClassicsCore_GetVersionName();
     const CTString strMod = "MOD:Classics Patch " + strVer + "\\" + CLASSICSPATCH_URL_TAGRELEASE(strVer);
@@ -440,6 +508,13 @@ void IProcessPacket::OnConnectRemoteSessionStateRequest(INDEX iClient, CNetworkM
     return;
   }
 
+#if _PATCHCONFIG_EXT_PACKETS
+  // [Cecil] Send packets in the patch format before a client without the patch starts receiving the game stream
+  if (!bPatchClient) {
+    CExtPacket::FlushBatch();
+  }
+#endif
+
   // Activate client socket and read parameters for it
   CSessionSocket &sso = _pNetwork->ga_srvServer.srv_assoSessions[iClient];
   sso.Activate();
@@ -448,6 +523,8 @@ void IProcessPacket::OnConnectRemoteSessionStateRequest(INDEX iClient, CNetworkM
   sso.sso_bVIP = bAutorizedAsVIP;
   sso.sso_sspParams = sspClient;
 
+  INetwork::InvalidateCensus();
+
   // Try to send base info
   try {
     static CSymbolPtr pstrMOTD("ser_strMOTD");
@@ -473,6 +550,8 @@ void IProcessPacket::OnConnectRemoteSessionStateRequest(INDEX iClient, CNetworkM
   // Abort on error
   } catch (char *strError) {
     sso.Deactivate();
+    INetwork::InvalidateCensus();
+
     CPrintF(LOCALIZE("Server: Cannot prepare connection data: %s\n"), strError);
   }
 };
@@ -539,6 +618,12 @@ void IProcessPacket::OnPlayerConnectRequest(INDEX iClient, CNetworkMessage &nmMe
 
     // Remember the character
     pplbNew->plb_pcCharacter = pcCharacter;
+    INetwork::InvalidateCensus();
+
+  #if _PATCHCONFIG_EXT_PACKETS
+    // [Cecil] Send queued extension packets before this block
+    CExtPacket::FlushBatch();
+  #endif
 
     const INDEX iLastSequence = ++srv.srv_iLastProcessedSequence;
 
@@ -566,15 +651,7 @@ void IProcessPacket::OnPlayerConnectRequest(INDEX iClient, CNetworkMessage &nmMe
   #if _PATCHCONFIG_GUID_MASKING
     // Send to other clients
     if (ShouldMaskGUIDs()) {
-      for (INDEX iSession = 0; iSession < srv.srv_assoSessions.Count(); iSession++) {
-        CSessionSocket &ssoBlock = srv.srv_assoSessions[iSession];
-
-        if (iSession == iClient || (iSession > 0 && !ssoBlock.IsActive())) {
-          continue;
-        }
-
-        INetwork::AddBlockToSession(nsbAddClientData, iSession);
-      }
+      INetwork::AddBlockToAllSessions(nsbAddClientData, iClient);
 
     } else
   #endif // _PATCHCONFIG_GUID_MASKING
@@ -665,6 +742,12 @@ void IProcessPacket::OnCharacterChangeRequest(INDEX iClient, CNetworkMessage &nm
 
   // Remember the character
   plb.plb_pcCharacter = pcCharacter;
+  INetwork::InvalidateCensus();
+
+#if _PATCHCONFIG_EXT_PACKETS
+  // [Cecil] Send queued extension packets before this block
+  CExtPacket::FlushBatch();
+#endif
 
   const INDEX iLastSequence = ++srv.srv_iLastProcessedSequence;
 
@@ -692,15 +775,7 @@ void IProcessPacket::OnCharacterChangeRequest(INDEX iClient, CNetworkMessage &nm
 #if _PATCHCONFIG_GUID_MASKING
   // Send to other clients
   if (ShouldMaskGUIDs()) {
-    for (INDEX iSession = 0; iSession < srv.srv_assoSessions.Count(); iSession++) {
-      CSessionSocket &ssoBlock = srv.srv_assoSessions[iSession];
-
-      if (iSession == iClient || (iSession > 0 && !ssoBlock.IsActive())) {
-        continue;
-      }
-
-      INetwork::AddBlockToSession(nsbChangeChar, iSession);
-    }
+    INetwork::AddBlockToAllSessions(nsbChangeChar, iClient);
 
   } else
 #endif // _PATCHCONFIG_GUID_MASKING
@@ -27,6 +27,7 @@ void CActiveClient::Set(CClientIdentity *pci, const SClientAddress &addrSet) {
   pClient = pci;
   addr = addrSet;
   eRole = E_CLIENT;
+  bPatchClient = FALSE;
 };
 
 // Reset the client to be inactive
@@ -35,6 +36,7 @@ void CActiveClient::Reset(void) {
   cPlayers.Clear();
   addr.SetIP(0);
   eRole = E_CLIENT;
+  bPatchClient = FALSE;
 
   ResetPacketCounters();
 };
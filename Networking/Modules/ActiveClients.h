@@ -52,9 +52,12 @@ class CORE_API CActiveClient {
     INDEX ctLastSecMessages; // Chat messages sent in the past second
     INDEX ctAnnoyanceLevel; // For kicking clients deemed too annoying in the past second (set by user; up to 100)
 
+    // Client is running the same patch version as the server
+    BOOL bPatchClient;
+
   public:
     // Default constructor
-    CActiveClient() : pClient(NULL), eRole(E_CLIENT)
+    CActiveClient() : pClient(NULL), eRole(E_CLIENT), bPatchClient(FALSE)
     {
       ResetPacketCounters();
     };
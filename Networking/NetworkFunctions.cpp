@@ -19,6 +19,10 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "MessageProcessing.h"
 #include "Modules.h"
 #include "ExtPackets.h"
+#include "Interfaces/HashFunctions.h"
+
+// Register handlers of network packets
+static void RegisterPacketHandlers(void);
 
 // Initialize networking
 void INetwork::Initialize(void) {
@@ -37,6 +41,10 @@ void INetwork::Initialize(void) {
   // Register commands for packet processing
   IProcessPacket::RegisterCommands();
 
+  // Register handlers of network packets
+  IMessageDispatch::Initialize();
+  RegisterPacketHandlers();
+
 #if _PATCHCONFIG_NEW_QUERY
   // Initialize query manager
   extern void InitQuery(void);
@@ -65,60 +73,183 @@ void INetwork::Initialize(void) {
   _pNetwork->ga_aplsPlayers.New(ICore::MAX_LOCAL_PLAYERS);
 };
 
-// Handle packets coming from a client
-// If output is TRUE, it will pass packets into engine's CServer::Handle()
-BOOL INetwork::ServerHandle(CMessageDispatcher *pmd, INDEX iClient, CNetworkMessage &nmMessage) {
-  CSessionSocket &sso = _pNetwork->ga_srvServer.srv_assoSessions[iClient];
-  sso.sso_tvMessageReceived = _pTimer->GetHighPrecisionTimer();
+// Hash character GUID for the census lookup table
+static inline ULONG HashCharacterGUID(const CPlayerCharacter &pc) {
+  return IHash::Data(pc.pc_aubGUID, sizeof(pc.pc_aubGUID));
+};
+
+// Gather everything from the server
+void SServerCensus::Gather(void) {
+  memset(this, 0, sizeof(*this));
+  memset(aubCharacters, 0xFF, sizeof(aubCharacters));
+
+  CServer &srv = _pNetwork->ga_srvServer;
+  const INDEX ctSessions = ClampUp(srv.srv_assoSessions.Count(), ICore::MAX_SERVER_CLIENTS);
+
+  for (INDEX iClient = 0; iClient < ctSessions; iClient++) {
+    CSessionSocket &sso = srv.srv_assoSessions[iClient];
+    const ULONG ulClient = (1UL << iClient);
+
+    // Server client is always active
+    if (iClient == 0 || sso.sso_bActive) {
+      ulClients |= ulClient;
+
+      if (sso.sso_bVIP) {
+        ulVIPClients |= ulClient;
+      }
+    }
+
+    // Clients without players
+    if ((iClient == 0 || sso.IsActive()) && sso.sso_ctLocalPlayers == 0) {
+      ulObservers |= ulClient;
+    }
+  }
+
+  const INDEX ctPlayers = ClampUp(srv.srv_aplbPlayers.Count(), (INDEX)32);
+  const ULONG ulMask = ARRAYCOUNT(aubCharacters) - 1;
+
+  for (INDEX iPlayer = 0; iPlayer < ctPlayers; iPlayer++) {
+    CPlayerBuffer &plb = srv.srv_aplbPlayers[iPlayer];
+    if (!plb.IsActive()) continue;
+
+    const ULONG ulPlayer = (1UL << iPlayer);
+    ulPlayers |= ulPlayer;
+
+    const INDEX iClient = plb.plb_iClient;
+
+    if (iClient >= 0 && iClient < ctSessions) {
+      aulClientPlayers[iClient] |= ulPlayer;
+
+      if (srv.srv_assoSessions[iClient].sso_bVIP) {
+        ulVIPPlayers |= ulPlayer;
+      }
+    }
+
+    // Take the next free slot
+    ULONG ulSlot = HashCharacterGUID(plb.plb_pcCharacter) & ulMask;
+
+    while (aubCharacters[ulSlot] != 0xFF) {
+      ulSlot = (ulSlot + 1) & ulMask;
+    }
+
+    aubCharacters[ulSlot] = (UBYTE)iPlayer;
+  }
+};
+
+// Find active player with the same character (-1 if none)
+INDEX SServerCensus::FindCharacter(const CPlayerCharacter &pc) const {
+  CServer &srv = _pNetwork->ga_srvServer;
+
+  const ULONG ulMask = ARRAYCOUNT(aubCharacters) - 1;
+  ULONG ulSlot = HashCharacterGUID(pc) & ulMask;
 
-  MESSAGETYPE ePacket = nmMessage.GetType();
-
-  // Process some default packets
-  switch (ePacket) {
-    // Client confirming the disconnection
-    case PCK_REP_DISCONNECTED:
-      IProcessPacket::OnClientDisconnect(iClient, nmMessage);
-      return FALSE;
-
-    // Client requesting the session state
-    case MSG_REQ_CONNECTREMOTESESSIONSTATE:
-      IProcessPacket::OnConnectRemoteSessionStateRequest(iClient, nmMessage);
-      return FALSE;
-
-    // Client requesting the connection to the server
-    case MSG_REQ_CONNECTPLAYER:
-      IProcessPacket::OnPlayerConnectRequest(iClient, nmMessage);
-      return FALSE;
-
-    // Client changing the character
-    case MSG_REQ_CHARACTERCHANGE:
-      IProcessPacket::OnCharacterChangeRequest(iClient, nmMessage);
-      return FALSE;
-
-    // Client sending player actions
-    case MSG_ACTION:
-      IProcessPacket::OnPlayerAction(iClient, nmMessage);
-      return FALSE;
-
-    // Client sending a CRC check
-    case MSG_SYNCCHECK:
-      IProcessPacket::OnSyncCheck(iClient, nmMessage);
-      return FALSE;
-
-    // Client sending a chat message
-    case MSG_CHAT_IN:
-      return IProcessPacket::OnChatInRequest(iClient, nmMessage);
+  while (aubCharacters[ulSlot] != 0xFF) {
+    const INDEX iPlayer = aubCharacters[ulSlot];
+    if (srv.srv_aplbPlayers[iPlayer].plb_pcCharacter == pc) return iPlayer;
+
+    ulSlot = (ulSlot + 1) & ulMask;
+  }
+
+  return -1;
+};
+
+// Census of active players and clients on the server
+static SServerCensus _census;
+
+// Game stream sequence at the moment of gathering the census
+static INDEX _iCensusSequence = -1;
+
+// Census needs to be gathered again
+static BOOL _bCensusOutdated = TRUE;
+
+// Forget the census so it's gathered again on the next request
+void INetwork::InvalidateCensus(void) {
+  _bCensusOutdated = TRUE;
+};
+
+// Get census of active players and clients on the server
+const SServerCensus &INetwork::GetCensus(void) {
+  // Players are added and removed along with new blocks in the game stream
+  const INDEX iSequence = _pNetwork->ga_srvServer.srv_iLastProcessedSequence;
+
+  if (_bCensusOutdated || _iCensusSequence != iSequence) {
+    _census.Gather();
+    _iCensusSequence = iSequence;
+    _bCensusOutdated = FALSE;
+  }
+
+#ifndef NDEBUG
+  // Make sure the census hasn't missed any changes
+  else {
+    SServerCensus censusCheck;
+    censusCheck.Gather();
+
+    if (memcmp(&censusCheck, &_census, sizeof(SServerCensus)) != 0) {
+      CPrintF("^cffff00Server census has missed some changes!\n");
+      _census = censusCheck;
+    }
   }
+#endif
+
+  return _census;
+};
+
+// Client confirming the disconnection
+static BOOL HandleClientDisconnect(INDEX iClient, CNetworkMessage &nmMessage) {
+  IProcessPacket::OnClientDisconnect(iClient, nmMessage);
+  return FALSE;
+};
+
+// Client requesting the session state
+static BOOL HandleSessionStateRequest(INDEX iClient, CNetworkMessage &nmMessage) {
+  IProcessPacket::OnConnectRemoteSessionStateRequest(iClient, nmMessage);
+  return FALSE;
+};
+
+// Client requesting the connection to the server
+static BOOL HandlePlayerConnectRequest(INDEX iClient, CNetworkMessage &nmMessage) {
+  IProcessPacket::OnPlayerConnectRequest(iClient, nmMessage);
+  return FALSE;
+};
+
+// Client changing the character
+static BOOL HandleCharacterChangeRequest(INDEX iClient, CNetworkMessage &nmMessage) {
+  IProcessPacket::OnCharacterChangeRequest(iClient, nmMessage);
+  return FALSE;
+};
+
+// Client sending player actions
+static BOOL HandlePlayerAction(INDEX iClient, CNetworkMessage &nmMessage) {
+  IProcessPacket::OnPlayerAction(iClient, nmMessage);
+  return FALSE;
+};
+
+// Client sending a CRC check
+static BOOL HandleSyncCheck(INDEX iClient, CNetworkMessage &nmMessage) {
+  IProcessPacket::OnSyncCheck(iClient, nmMessage);
+  return FALSE;
+};
+
+// Client sending a chat message
+static BOOL HandleChatInRequest(INDEX iClient, CNetworkMessage &nmMessage) {
+  return IProcessPacket::OnChatInRequest(iClient, nmMessage);
+};
 
 #if _PATCHCONFIG_EXT_PACKETS
 
-  // Let CServer::Handle process packets of other types
-  if (ePacket != PCK_EXTENSION) return TRUE;
+// Client requesting the current game state
+static BOOL HandleStateDeltaRequest(INDEX iClient, CNetworkMessage &nmMessage) {
+  // Send queued packets that have been written against the current baselines and class files
+  CExtPacket::FlushBatch();
 
-  // Handle specific packet types
-  ULONG ulType;
-  INetDecompress::Integer(nmMessage, ulType);
+  // Joining client will only know about entity placements and class files sent after this point
+  CExtEntityPacket::ResetBaselines(TRUE, FALSE);
+  CExtEntityCreate::ResetLearnedClasses(TRUE, FALSE);
+  return TRUE;
+};
 
+// Let plugins and built-in packets handle extension packets from clients
+static BOOL HandleServerExtPacket(CNetworkMessage &nmMessage, ULONG ulType) {
   // Let plugins handle packets
   FOREACHPLUGIN(itPlugin) {
     if (itPlugin->pm_events.m_network->OnServerPacket == NULL) continue;
@@ -126,7 +257,7 @@ BOOL INetwork::ServerHandle(CMessageDispatcher *pmd, INDEX iClient, CNetworkMess
     // Handle packet through this plugin handler
     if (itPlugin->pm_events.m_network->OnServerPacket(nmMessage, ulType)) {
       // Quit if packet has been handled
-      return FALSE;
+      return TRUE;
     }
   }
 
@@ -134,7 +265,7 @@ BOOL INetwork::ServerHandle(CMessageDispatcher *pmd, INDEX iClient, CNetworkMess
 
   // Only create packets that can come from clients
   if (ulType >= IClassicsExtPacket::k_EPacketType_FirstC2S) {
-    pPacket = CExtPacket::CreatePacket((IClassicsExtPacket::EPacketType)ulType);
+    pPacket = CExtPacket::AcquireReceived((IClassicsExtPacket::EPacketType)ulType);
   }
 
   // No built-in packet under this index
@@ -149,30 +280,23 @@ BOOL INetwork::ServerHandle(CMessageDispatcher *pmd, INDEX iClient, CNetworkMess
   pPacket->Read(nmMessage);
   pPacket->Process();
 
-  // No extra processing needed
-  delete pPacket;
-  return FALSE;
-
-#else
-
-  // Let CServer::Handle process packets of other types
+  CExtPacket::ReleaseReceived(pPacket);
   return TRUE;
-
-#endif // _PATCHCONFIG_EXT_PACKETS
 };
 
-// Handle packets coming from a server
-// If output is TRUE, it will pass packets into engine's CSessionState::ProcessGameStreamBlock()
-BOOL INetwork::ClientHandle(CSessionState *pses, CNetworkMessage &nmMessage) {
-#if _PATCHCONFIG_EXT_PACKETS
-
-  // Let default methods handle packets of other types
-  if (nmMessage.GetType() != PCK_EXTENSION) return TRUE;
-
+// Client sending an extension packet
+static BOOL HandleServerExtension(INDEX iClient, CNetworkMessage &nmMessage) {
   // Handle specific packet types
   ULONG ulType;
   INetDecompress::Integer(nmMessage, ulType);
 
+  // No extra processing needed
+  IMessageDispatch::ServerExt(nmMessage, ulType, &HandleServerExtPacket);
+  return FALSE;
+};
+
+// Let plugins and built-in packets handle extension packets from a server
+static BOOL HandleClientExtPacket(CNetworkMessage &nmMessage, ULONG ulType) {
   // Let plugins handle packets
   FOREACHPLUGIN(itPlugin) {
     if (itPlugin->pm_events.m_network->OnClientPacket == NULL) continue;
@@ -180,7 +304,7 @@ BOOL INetwork::ClientHandle(CSessionState *pses, CNetworkMessage &nmMessage) {
     // Handle packet through this plugin handler
     if (itPlugin->pm_events.m_network->OnClientPacket(nmMessage, ulType)) {
       // Quit if packet has been handled
-      return FALSE;
+      return TRUE;
     }
   }
 
@@ -188,7 +312,7 @@ BOOL INetwork::ClientHandle(CSessionState *pses, CNetworkMessage &nmMessage) {
 
   // Only create packets that can come from a server
   if (ulType <= IClassicsExtPacket::k_EPacketType_LastS2C) {
-    pPacket = CExtPacket::CreatePacket((IClassicsExtPacket::EPacketType)ulType);
+    pPacket = CExtPacket::AcquireReceived((IClassicsExtPacket::EPacketType)ulType);
   }
 
   // No built-in packet under this index
@@ -203,16 +327,91 @@ BOOL INetwork::ClientHandle(CSessionState *pses, CNetworkMessage &nmMessage) {
   pPacket->Read(nmMessage);
   pPacket->Process();
 
+  CExtPacket::ReleaseReceived(pPacket);
+  return TRUE;
+};
+
+// Server sending an extension packet
+static BOOL HandleClientExtension(CSessionState *pses, CNetworkMessage &nmMessage) {
+  // Handle specific packet types
+  ULONG ulType;
+  INetDecompress::Integer(nmMessage, ulType);
+
   // No extra processing needed
-  delete pPacket;
+  IMessageDispatch::ClientExt(nmMessage, ulType, &HandleClientExtPacket);
   return FALSE;
+};
 
-#else
+// Server sending multiple extension packets in one block
+static BOOL HandleClientExtensionBatch(CSessionState *pses, CNetworkMessage &nmMessage) {
+  ULONG ctRecords;
+  INetDecompress::Integer(nmMessage, ctRecords);
 
-  // Let CSessionState::ProcessGameStreamBlock process packets of other types
-  return TRUE;
+  UBYTE ubPatchFormat = 0;
+  nmMessage.ReadBits(&ubPatchFormat, 1);
+
+  const UBYTE *pubEnd = nmMessage.nm_pubMessage + nmMessage.nm_slSize;
+
+  // Read packets in the same format they have been written in
+  CExtPacket::_bPatchFormat = ubPatchFormat;
+
+  // Handle batched packets one by one in the order they were sent
+  for (ULONG i = 0; i < ctRecords; i++) {
+    // Not enough data for the rest of the packets
+    if (nmMessage.nm_pubPointer + sizeof(SLONG) > pubEnd) {
+      CPrintF(TRANS("Client received a PCK_EXTENSION_BATCH with %u/%u packets!\n"), i, ctRecords);
+      ASSERT(FALSE);
+      break;
+    }
+
+    CNetworkMessage nmRecord;
+    nmMessage.ExtractSubMessage(nmRecord);
+    IMessageDispatch::Client(pses, nmRecord);
+  }
+
+  CExtPacket::_bPatchFormat = FALSE;
+  return FALSE;
+};
 
 #endif // _PATCHCONFIG_EXT_PACKETS
+
+// Register handlers of network packets
+static void RegisterPacketHandlers(void) {
+  IMessageDispatch::SetServerHandler(INetwork::PCK_REP_DISCONNECTED,     &HandleClientDisconnect);
+  IMessageDispatch::SetServerHandler(MSG_REQ_CONNECTREMOTESESSIONSTATE, &HandleSessionStateRequest);
+  IMessageDispatch::SetServerHandler(MSG_REQ_CONNECTPLAYER,             &HandlePlayerConnectRequest);
+  IMessageDispatch::SetServerHandler(MSG_REQ_CHARACTERCHANGE,           &HandleCharacterChangeRequest);
+  IMessageDispatch::SetServerHandler(MSG_ACTION,                        &HandlePlayerAction);
+  IMessageDispatch::SetServerHandler(MSG_SYNCCHECK,                     &HandleSyncCheck);
+  IMessageDispatch::SetServerHandler(MSG_CHAT_IN,                       &HandleChatInRequest);
+
+#if _PATCHCONFIG_EXT_PACKETS
+  IMessageDispatch::SetServerHandler(MSG_REQ_STATEDELTA,       &HandleStateDeltaRequest);
+  IMessageDispatch::SetServerHandler(INetwork::PCK_EXTENSION, &HandleServerExtension);
+
+  IMessageDispatch::SetClientHandler(INetwork::PCK_EXTENSION_BATCH, &HandleClientExtensionBatch);
+  IMessageDispatch::SetClientHandler(INetwork::PCK_EXTENSION,       &HandleClientExtension);
+#endif
+};
+
+// Handle packets coming from a client
+// If output is TRUE, it will pass packets into engine's CServer::Handle()
+BOOL INetwork::ServerHandle(CMessageDispatcher *pmd, INDEX iClient, CNetworkMessage &nmMessage) {
+  CSessionSocket &sso = _pNetwork->ga_srvServer.srv_assoSessions[iClient];
+  sso.sso_tvMessageReceived = _pTimer->GetHighPrecisionTimer();
+
+  // Clients may have changed their state since the last message
+  InvalidateCensus();
+
+  // Process packets through their handlers
+  return IMessageDispatch::Server(iClient, nmMessage);
+};
+
+// Handle packets coming from a server
+// If output is TRUE, it will pass packets into engine's CSessionState::ProcessGameStreamBlock()
+BOOL INetwork::ClientHandle(CSessionState *pses, CNetworkMessage &nmMessage) {
+  // Process packets through their handlers
+  return IMessageDispatch::Client(pses, nmMessage);
 };
 
 // Send disconnect message to a client (CServer::SendDisconnectMessage reimplementation)
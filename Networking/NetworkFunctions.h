@@ -23,6 +23,40 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "CommInterface.h"
 #include "StreamBlock.h"
 #include "MessageCompression.h"
+#include "MessageDispatch.h"
+
+// Active players and clients on the server gathered in one pass
+// Players and clients are stored as bit masks of their indices
+struct CORE_API SServerCensus {
+  ULONG ulPlayers;    // Active players
+  ULONG ulVIPPlayers; // Active players of VIP clients
+  ULONG ulClients;    // Active clients (including the server client)
+  ULONG ulVIPClients; // Active VIP clients
+  ULONG ulObservers;  // Active clients without players
+
+  // Active players of each client
+  ULONG aulClientPlayers[ICore::MAX_SERVER_CLIENTS];
+
+  // Open addressing table of active player indices by hashes of character GUIDs (0xFF for empty slots)
+  UBYTE aubCharacters[64];
+
+  // Gather everything from the server
+  void Gather(void);
+
+  // Find active player with the same character (-1 if none)
+  INDEX FindCharacter(const CPlayerCharacter &pc) const;
+
+  // Count set bits in a mask
+  static inline INDEX CountBits(ULONG ulMask) {
+    INDEX ct = 0;
+
+    for (; ulMask != 0; ct++) {
+      ulMask &= ulMask - 1;
+    }
+
+    return ct;
+  };
+};
 
 // Interface of network methods
 class CORE_API INetwork {
@@ -35,9 +69,12 @@ class CORE_API INetwork {
       // Start with 49 to continue the MESSAGETYPE / NetworkMessageType list
       PCK_DUMMY_NETWORK_PACKET = 49,
 
-      // Allow 49-62 range for mod packets
+      // Allow 49-61 range for mod packets
 
     #if _PATCHCONFIG_EXT_PACKETS
+      // Multiple extension packets in one block (only sent to patch clients)
+      PCK_EXTENSION_BATCH = 62,
+
       // Occupy the last index for new packets (cannot go above 63)
       PCK_EXTENSION = 63,
     #endif
@@ -77,11 +114,23 @@ class CORE_API INetwork {
       }
     };
 
-    // Add stream block to all sessions
-    static inline void AddBlockToAllSessions(CNetStreamBlock &nsb) {
+    // Add stream block to all sessions (except for one, if specified)
+    static inline void AddBlockToAllSessions(CNetStreamBlock &nsb, INDEX iExceptSession = -1) {
+      CServer &srv = _pNetwork->ga_srvServer;
+
+      // [Cecil] Prepare payload once for all sessions
+      CNetBroadcastBlock nbb(nsb);
+
       // For each active session
-      for (INDEX i = 0; i < _pNetwork->ga_srvServer.srv_assoSessions.Count(); i++) {
-        AddBlockToSession(nsb, i);
+      for (INDEX i = 0; i < srv.srv_assoSessions.Count(); i++) {
+        if (i == iExceptSession) continue;
+
+        CSessionSocket &sso = srv.srv_assoSessions[i];
+
+        // Add block to the buffer if client is active (server client always is)
+        if (i == 0 || sso.IsActive()) {
+          ((CNetStream &)sso.sso_nsBuffer).AddBroadcastBlock(nbb);
+        }
       }
     };
 
@@ -112,97 +161,48 @@ class CORE_API INetwork {
   // CServer method reimplementations
   public:
 
+    // Forget the census so it's gathered again on the next request
+    static void InvalidateCensus(void);
+
+    // Get census of active players and clients on the server
+    static const SServerCensus &GetCensus(void);
+
     // Get number of active players
     // Reimplementation of CServer::GetPlayersCount() and CServer::GetVIPPlayersCount() methods
     static inline INDEX CountPlayers(BOOL bOnlyVIP) {
-      CServer &srv = _pNetwork->ga_srvServer;
-      INDEX ctPlayers = 0;
-
-      FOREACHINSTATICARRAY(srv.srv_aplbPlayers, CPlayerBuffer, itplb)
-      {
-        // Skip inactive players
-        if (!itplb->IsActive()) continue;
-
-        // Any or VIP
-        if (!bOnlyVIP || srv.srv_assoSessions[itplb->plb_iClient].sso_bVIP) {
-          ctPlayers++;
-        }
-      }
-
-      return ctPlayers;
+      const SServerCensus &census = GetCensus();
+      return SServerCensus::CountBits(bOnlyVIP ? census.ulVIPPlayers : census.ulPlayers);
     };
 
     // Get number of active clients
     // Reimplementation of CServer::GetClientsCount() and CServer::GetVIPClientsCount() methods
     static inline INDEX CountClients(BOOL bOnlyVIP) {
-      CServer &srv = _pNetwork->ga_srvServer;
-
-      const INDEX ctSessions = srv.srv_assoSessions.Count();
-      INDEX ctClients = 0;
-
-      for (INDEX i = 0; i < ctSessions; i++) {
-        CSessionSocket &sso = srv.srv_assoSessions[i];
-
-        // Skip inactive clients
-        if (i > 0 && !sso.sso_bActive) continue;
-
-        // Any or VIP
-        if (!bOnlyVIP || sso.sso_bVIP) {
-          ctClients++;
-        }
-      }
-
-      return ctClients;
+      const SServerCensus &census = GetCensus();
+      return SServerCensus::CountBits(bOnlyVIP ? census.ulVIPClients : census.ulClients);
     };
 
     // Get number of active observers
     // Reimplementation of CServer::GetObserversCount() method
     static inline INDEX CountObservers(void) {
-      CServer &srv = _pNetwork->ga_srvServer;
-
-      const INDEX ctSessions = srv.srv_assoSessions.Count();
-      INDEX ctClients = 0;
-
-      for (INDEX i = 0; i < ctSessions; i++) {
-        CSessionSocket &sso = srv.srv_assoSessions[i];
-
-        // Skip inactive clients
-        if (i > 0 && !sso.IsActive()) continue;
-
-        // Client with no players
-        if (sso.sso_ctLocalPlayers == 0) {
-          ctClients++;
-        }
-      }
-
-      return ctClients;
+      return SServerCensus::CountBits(GetCensus().ulObservers);
     };
 
     // Get number of active players of a specific client
     static inline INDEX CountClientPlayers(INDEX iClient) {
-      CServer &srv = _pNetwork->ga_srvServer;
-      INDEX ctPlayers = 0;
-
-      FOREACHINSTATICARRAY(srv.srv_aplbPlayers, CPlayerBuffer, itplb)
-      {
-        // Active player with a matching client index
-        if (itplb->IsActive() && itplb->plb_iClient == iClient) {
-          ctPlayers++;
-        }
-      }
-
-      return ctPlayers;
+      return SServerCensus::CountBits(MaskOfClientPlayers(iClient));
     };
 
     // Find first inactive client
     static inline CPlayerBuffer *FirstInactivePlayer(void) {
       CServer &srv = _pNetwork->ga_srvServer;
+      const ULONG ulPlayers = GetCensus().ulPlayers;
 
-      FOREACHINSTATICARRAY(srv.srv_aplbPlayers, CPlayerBuffer, itplb)
-      {
+      const INDEX ctPlayers = srv.srv_aplbPlayers.Count();
+
+      for (INDEX i = 0; i < ctPlayers; i++) {
         // Found inactive player
-        if (!itplb->IsActive()) {
-          return itplb;
+        if (!(ulPlayers & (1UL << i))) {
+          return &srv.srv_aplbPlayers[i];
         }
       }
 
@@ -212,37 +212,14 @@ class CORE_API INetwork {
 
     // Check if some character already exists in this session
     static inline BOOL IsCharacterUsed(const CPlayerCharacter &pc) {
-      CServer &srv = _pNetwork->ga_srvServer;
-
-      FOREACHINSTATICARRAY(srv.srv_aplbPlayers, CPlayerBuffer, itplb)
-      {
-        // Active player with a matching character
-        if (itplb->IsActive() && itplb->plb_pcCharacter == pc) {
-          return TRUE;
-        }
-      }
-
-      // No matching character found
-      return FALSE;
+      return GetCensus().FindCharacter(pc) != -1;
     };
 
     // Compose a bit mask of all players of a specific client
     static inline ULONG MaskOfClientPlayers(INDEX iClient) {
-      CServer &srv = _pNetwork->ga_srvServer;
-
-      const INDEX ctPlayers = srv.srv_aplbPlayers.Count();
-      ULONG ulMask = 0;
-
-      for (INDEX i = 0; i < ctPlayers; i++) {
-        CPlayerBuffer &plb = srv.srv_aplbPlayers[i];
-
-        // Active player with a matching client index
-        if (plb.IsActive() && plb.plb_iClient == iClient) {
-          ulMask |= (1UL << i);
-        }
-      }
+      if (iClient < 0 || iClient >= ICore::MAX_SERVER_CLIENTS) return 0;
 
-      return ulMask;
+      return GetCensus().aulClientPlayers[iClient];
     };
 };
 
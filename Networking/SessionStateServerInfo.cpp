@@ -16,6 +16,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include "StdH.h"
 
 #include "MessageProcessing.h"
+#include "ExtPackets.h"
 
 // Write patch identification tag into a stream
 void IProcessPacket::WritePatchTag(CTStream &strm) {
@@ -62,10 +63,19 @@ BOOL IProcessPacket::ReadPatchTag(CTStream &strm, ULONG *pulReadVersion) {
   return TRUE;
 };
 
-#if _PATCHCONFIG_GAMEPLAY_EXT
-
 // Reset data before starting any session
 void IProcessPacket::ResetSessionData(BOOL bNewSetup) {
+#if _PATCHCONFIG_EXT_PACKETS
+  // Forget entity placements and class files from the previous session
+  CExtEntityPacket::ResetBaselines(TRUE, TRUE);
+  CExtEntityCreate::ResetLearnedClasses(TRUE, TRUE);
+
+  // Discard extension packets queued in the previous session
+  CExtPacket::ResetBatch();
+  CExtPacket::ResetQueue();
+#endif
+
+#if _PATCHCONFIG_GAMEPLAY_EXT
   // Set new data
   if (bNewSetup && GameplayExtEnabled()) {
     IConfig::gex = _gexSetup;
@@ -74,8 +84,11 @@ void IProcessPacket::ResetSessionData(BOOL bNewSetup) {
   } else {
     IConfig::gex.Reset(TRUE);
   }
+#endif // _PATCHCONFIG_GAMEPLAY_EXT
 };
 
+#if _PATCHCONFIG_GAMEPLAY_EXT
+
 // Available data chunks
 static const CChunkID _cidTimers0("TMR0"); // Fix logic timers = false
 static const CChunkID _cidTimers1("TMR1"); // Fix logic timers = true
@@ -181,11 +194,6 @@ void IProcessPacket::ReadServerInfoFromSessionState(CTStream &strm) {
 
 #else
 
-// Reset data before starting any session
-void IProcessPacket::ResetSessionData(BOOL bNewSetup)
-{
-};
-
 // Append extra info about the patched server
 void IProcessPacket::WriteServerInfoToSessionState(CTStream &strm)
 {
@@ -92,8 +92,41 @@ void CNetStreamBlock::Read_t(CTStream &strm) {
   nm_mtType = (MESSAGETYPE)ubType;
 };
 
+// [Cecil] Constructor from a block that's been written
+CNetBroadcastBlock::CNetBroadcastBlock(CNetStreamBlock &nsbBlock) :
+  nbb_nsbPayload(nsbBlock)
+{
+  nbb_nsbPayload.Shrink();
+};
+
+// [Cecil] Create a copy of the block for one stream
+CNetStreamBlock *CNetBroadcastBlock::CreateBlock(void) const {
+  // Copy is allocated with the size of the shrunk payload
+  CNetStreamBlock *pnsbCopy = new CNetStreamBlock((CNetStreamBlock &)nbb_nsbPayload);
+
+  if (pnsbCopy->nm_slMaxSize != pnsbCopy->nm_slSize) {
+    pnsbCopy->Shrink();
+  }
+
+  return pnsbCopy;
+};
+
 // Add block that's already allocated to the stream
 void CNetStream::AddAllocatedBlock(CNetStreamBlock *pnsbBlock) {
+  const INDEX iSequence = pnsbBlock->nsb_iSequenceNumber;
+
+  // [Cecil] Blocks are mostly added in order, so add newer blocks right away
+  if (ns_lhBlocks.IsEmpty() || LIST_HEAD(ns_lhBlocks, CNetStreamBlock, nsb_lnInStream)->nsb_iSequenceNumber < iSequence) {
+    ns_lhBlocks.AddHead(pnsbBlock->nsb_lnInStream);
+    return;
+  }
+
+  // [Cecil] Older than all of the blocks
+  if (LIST_TAIL(ns_lhBlocks, CNetStreamBlock, nsb_lnInStream)->nsb_iSequenceNumber > iSequence) {
+    ns_lhBlocks.AddTail(pnsbBlock->nsb_lnInStream);
+    return;
+  }
+
   // Preserve iterator for later use
   LISTITER(CNetStreamBlock, nsb_lnInStream) itnsbInList(ns_lhBlocks);
 
@@ -130,6 +163,11 @@ void CNetStream::AddBlock(CNetStreamBlock &nsbBlock) {
   AddAllocatedBlock(pnsbCopy);
 };
 
+// [Cecil] Add broadcast block to the stream (makes a copy of it)
+void CNetStream::AddBroadcastBlock(const CNetBroadcastBlock &nbbBlock) {
+  AddAllocatedBlock(nbbBlock.CreateBlock());
+};
+
 // Remove all blocks with older sequence number
 void CNetStream::RemoveOlderBlocksBySequence(INDEX iLastSequenceToKeep) {
   // Remove from the tail as long as it's not too old
@@ -53,6 +53,21 @@ class CORE_API CNetStreamBlock : public CNetworkMessage {
     void Read_t(CTStream &strm);
 };
 
+// [Cecil] Block that's being added to streams of multiple sessions
+// Blocks in streams are freed by the engine, so each stream still needs its own payload, but the
+// payload is shrunk only once here, so each copy is allocated at its exact size and copied once
+class CORE_API CNetBroadcastBlock {
+  public:
+    CNetStreamBlock nbb_nsbPayload; // Shrunk copy of the original block
+
+  public:
+    // Constructor from a block that's been written
+    CNetBroadcastBlock(CNetStreamBlock &nsbBlock);
+
+    // Create a copy of the block for one stream
+    CNetStreamBlock *CreateBlock(void) const;
+};
+
 // Stream of message blocks that can be sent across network
 // Reimplementation of Serious Engine's CNetworkStream
 class CORE_API CNetStream {
@@ -66,6 +81,9 @@ class CORE_API CNetStream {
     // Add block to the stream (makes a copy of it)
     void AddBlock(CNetStreamBlock &nsbBlock);
 
+    // [Cecil] Add broadcast block to the stream (makes a copy of it)
+    void AddBroadcastBlock(const CNetBroadcastBlock &nbbBlock);
+
     // Remove all blocks with older sequence number
     void RemoveOlderBlocksBySequence(INDEX iLastSequenceToKeep);
 };